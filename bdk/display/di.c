@@ -677,6 +677,22 @@ u32 *display_init_framebuffer_log()
 	return (u32 *)LOG_FB_ADDRESS;
 }
 
+void display_set_framebuffer(void *fb)
+{
+	DISPLAY_A(_DIREG(DC_CMD_DISPLAY_WINDOW_HEADER)) = WINDOW_A_SELECT; // Select window A.
+	DISPLAY_A(_DIREG(DC_WINBUF_START_ADDR)) = (u32)fb;
+
+	// Arm and activate changes. New address gets latched on next frame start.
+	DISPLAY_A(_DIREG(DC_CMD_STATE_CONTROL)) = GENERAL_UPDATE | WIN_A_UPDATE;
+	DISPLAY_A(_DIREG(DC_CMD_STATE_CONTROL)) = GENERAL_ACT_REQ | WIN_A_ACT_REQ;
+}
+
+bool display_framebuffer_flip_pending()
+{
+	// Activation request bit gets cleared by hardware when the flip is latched.
+	return !!(DISPLAY_A(_DIREG(DC_CMD_STATE_CONTROL)) & WIN_A_ACT_REQ);
+}
+
 void display_activate_console()
 {
 	DISPLAY_A(_DIREG(DC_CMD_DISPLAY_WINDOW_HEADER)) = WINDOW_D_SELECT; // Select window D.
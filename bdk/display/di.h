@@ -712,6 +712,8 @@ u32 *display_init_framebuffer_pitch();
 u32 *display_init_framebuffer_pitch_inv();
 u32 *display_init_framebuffer_block();
 u32 *display_init_framebuffer_log();
+void display_set_framebuffer(void *fb);
+bool display_framebuffer_flip_pending();
 void display_activate_console();
 void display_deactivate_console();
 void display_init_cursor(void *crs_fb, u32 size);
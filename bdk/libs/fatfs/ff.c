@@ -3865,7 +3865,21 @@ FRESULT f_read (
 			cc = btr / SS(fs);					/* When remaining bytes >= sector size, */
 			if (cc > 0) {						/* Read maximum contiguous sectors directly */
 				if (csect + cc > fs->csize) {	/* Clip at cluster boundary */
-					cc = fs->csize - csect;
+#if FF_USE_FASTSEEK
+					if (fp->cltbl) {			/* Extend over physically contiguous clusters from the CLMT */
+						UINT ccmax = cc;
+						cc = fs->csize - csect;
+						while (cc + fs->csize <= ccmax) {
+							clst = clmt_clust(fp, fp->fptr + (FSIZE_t)cc * SS(fs));
+							if (clst != fp->clust + 1) break;
+							fp->clust = clst;
+							cc += fs->csize;
+						}
+					} else
+#endif
+					{
+						cc = fs->csize - csect;
+					}
 				}
 				if (disk_read(fs->pdrv, rbuff, sect, cc) != RES_OK) {
 					EFSPRINTF("RLIO");
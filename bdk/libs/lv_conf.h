@@ -105,6 +105,8 @@
  * - LV_VDB_SIZE = LV_HOR_RES * LV_VER_RES
  * - LV_VDB_DOUBLE = 1
  */
+/* Nyx: Scan out is rotated, so the VDB can't be used as a frame buffer.
+ * Double buffering is done in `disp_drv.disp_flush` with two frame buffers flipped on vblank.*/
 #define LV_VDB_TRUE_DOUBLE_BUFFERED 0
 
 /*=================
@@ -207,6 +209,11 @@
 
 #define LV_FONT_DEFAULT        &interui_30     /*Always set a default font from the built-in fonts*/
 
+/* Cache decoded letters as 8 bit alpha masks with row spans.
+ * Least recently used letters are evicted when full.
+ * Size of the cache in bytes. 0: disable*/
+#define LV_GLYPH_CACHE_SIZE    (256 * 1024)
+
 /*===================
  *  LV_OBJ SETTINGS
  *==================*/
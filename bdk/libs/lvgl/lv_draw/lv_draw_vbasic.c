@@ -13,6 +13,7 @@
 #include "../lv_misc/lv_font.h"
 #include "../lv_misc/lv_color.h"
 #include "../lv_misc/lv_log.h"
+#include "../lv_misc/lv_mem.h"
 
 #if LV_VDB_SIZE != 0
 
@@ -33,9 +34,32 @@
 #define LV_ATTRIBUTE_MEM_ALIGN
 #endif
 
+#ifndef LV_GLYPH_CACHE_SIZE
+#define LV_GLYPH_CACHE_SIZE 0
+#endif
+
+#define USE_GLYPH_CACHE     (LV_GLYPH_CACHE_SIZE != 0 && LV_COLOR_SCREEN_TRANSP == 0)
+
+#if USE_GLYPH_CACHE
+#define GLYPH_CACHE_SETS    128     /*Must be power of 2*/
+#define GLYPH_CACHE_WAYS    4
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
+#if USE_GLYPH_CACHE
+typedef struct
+{
+    const lv_font_t * font;
+    uint32_t letter;
+    uint32_t last_use;
+    uint8_t * data;             /*Start and end column of each row, then the 8 bit alpha mask*/
+    uint16_t size;
+    uint8_t w;
+    lv_opa_t opa;
+} glyph_cache_entry_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
@@ -47,9 +71,20 @@ static void sw_color_fill(lv_area_t * mem_area, lv_color_t * mem, const lv_area_
 static inline lv_color_t color_mix_2_alpha(lv_color_t bg_color, lv_opa_t bg_opa, lv_color_t fg_color, lv_opa_t fg_opa);
 #endif
 
+#if USE_GLYPH_CACHE
+static const glyph_cache_entry_t * glyph_cache_get(const lv_font_t * font_p, uint32_t letter, lv_opa_t opa,
+                                                   const uint8_t * map_p, uint8_t letter_w, uint8_t letter_h,
+                                                   uint8_t bpp, const uint8_t * bpp_opa_table, uint8_t mask_init);
+#endif
+
 /**********************
  *  STATIC VARIABLES
  **********************/
+#if USE_GLYPH_CACHE
+static glyph_cache_entry_t glyph_cache[GLYPH_CACHE_SETS][GLYPH_CACHE_WAYS];
+static uint32_t glyph_cache_used;
+static uint32_t glyph_cache_tick;
+#endif
 
 /**********************
  *      MACROS
@@ -324,11 +359,43 @@ void lv_vletter(const lv_point_t * pos_p, const lv_area_t * mask_p,
     /*If the letter is partially out of mask the move there on VDB*/
     vdb_buf_tmp += (row_start * vdb_width) + col_start;
 
+    lv_disp_t * disp = lv_disp_get_active();
+
+#if USE_GLYPH_CACHE
+    /*Draw the visible spans of the cached alpha mask*/
+    if(disp->driver.vdb_wr == NULL) {
+        const glyph_cache_entry_t * glyph = glyph_cache_get(font_p, letter, opa, map_p, letter_w, letter_h,
+                                                            bpp, bpp_opa_table, mask_init);
+        if(glyph) {
+            const uint8_t * span_p = glyph->data;
+            const uint8_t * alpha_p = glyph->data + letter_h * 2;
+
+            for(row = row_start; row < row_end; row++) {
+                lv_coord_t span_start = span_p[row * 2];
+                lv_coord_t span_end = span_p[row * 2 + 1];
+                if(span_start < col_start) span_start = col_start;
+                if(span_end > col_end) span_end = col_end;
+
+                const uint8_t * a_p = &alpha_p[row * letter_w];
+                lv_color_t * px_p = vdb_buf_tmp - col_start;
+                for(col = span_start; col < span_end; col++) {
+                    lv_opa_t a = a_p[col];
+                    if(a == LV_OPA_TRANSP) continue;
+
+                    if(a == LV_OPA_COVER) px_p[col] = color;
+                    else px_p[col] = lv_color_mix(color, px_p[col], a);
+                }
+
+                vdb_buf_tmp += vdb_width;
+            }
+            return;
+        }
+    }
+#endif
+
     /*Move on the map too*/
     map_p += (row_start * width_byte_bpp) + ((col_start * bpp) >> 3);
 
-    lv_disp_t * disp = lv_disp_get_active();
-
     uint8_t letter_px;
     lv_opa_t px_opa;
     for(row = row_start; row < row_end; row ++) {
@@ -557,6 +624,8 @@ void lv_vmap(const lv_area_t * cords_p, const lv_area_t * mask_p,
  */
 static void sw_mem_blend(lv_color_t * dest, const lv_color_t * src, uint32_t length, lv_opa_t opa)
 {
+    if(opa == LV_OPA_TRANSP) return;
+
     if(opa == LV_OPA_COVER) {
         memcpy(dest, src, length * sizeof(lv_color_t));
     } else {
@@ -595,13 +664,20 @@ static void sw_color_fill(lv_area_t * mem_area, lv_color_t * mem, const lv_area_
         /*Run simpler function without opacity*/
         if(opa == LV_OPA_COVER) {
 
-            /*Fill the first row with 'color'*/
-            for(col = fill_area->x1; col <= fill_area->x2; col++) {
-                mem[col] = color;
+            /*Fill the first row with 'color'. Store 4 pixels per iteration*/
+            lv_color_t * mem_first = &mem[fill_area->x1];
+            lv_coord_t fill_w = fill_area->x2 - fill_area->x1 + 1;
+            for(col = 0; col + 3 < fill_w; col += 4) {
+                mem_first[col]     = color;
+                mem_first[col + 1] = color;
+                mem_first[col + 2] = color;
+                mem_first[col + 3] = color;
+            }
+            for(; col < fill_w; col++) {
+                mem_first[col] = color;
             }
 
             /*Copy the first row to all other rows*/
-            lv_color_t * mem_first = &mem[fill_area->x1];
             lv_coord_t copy_size = (fill_area->x2 - fill_area->x1 + 1) * sizeof(lv_color_t);
             mem += mem_width;
 
@@ -613,6 +689,32 @@ static void sw_color_fill(lv_area_t * mem_area, lv_color_t * mem, const lv_area_
         /*Calculate with alpha too*/
         else {
 
+#if LV_COLOR_SCREEN_TRANSP == 0 && LV_COLOR_DEPTH == 32
+            /*Foreground part of the mix is constant, so premultiply it once.
+             *Then only the background needs one multiply per packed lane pair*/
+            uint32_t bg_opa = 255 - opa;
+            uint32_t fg_rb = (color.full & 0x00FF00FF) * opa;
+            uint32_t fg_g  = ((color.full & 0x0000FF00) >> 8) * opa;
+            uint32_t bg_tmp = LV_COLOR_BLACK.full;
+            uint32_t opa_tmp = lv_color_mix(color, LV_COLOR_BLACK, opa).full;
+
+            for(row = fill_area->y1; row <= fill_area->y2; row++) {
+                uint32_t * mem32 = (uint32_t *)mem;
+                for(col = fill_area->x1; col <= fill_area->x2; col++) {
+                    /*If the bg color changed recalculate the result color*/
+                    uint32_t bg = mem32[col];
+                    if(bg != bg_tmp) {
+                        uint32_t rb = (fg_rb + (bg & 0x00FF00FF) * bg_opa) >> 8;
+                        uint32_t g  = fg_g + ((bg & 0x0000FF00) >> 8) * bg_opa;
+                        bg_tmp = bg;
+                        opa_tmp = 0xFF000000 | (0x00FF00FF & rb) | (0x0000FF00 & g);
+                    }
+
+                    mem32[col] = opa_tmp;
+                }
+                mem += mem_width;
+            }
+#else
 #if LV_COLOR_SCREEN_TRANSP == 0
             lv_color_t bg_tmp = LV_COLOR_BLACK;
             lv_color_t opa_tmp = lv_color_mix(color, bg_tmp, opa);
@@ -634,10 +736,135 @@ static void sw_color_fill(lv_area_t * mem_area, lv_color_t * mem, const lv_area_
                 }
                 mem += mem_width;
             }
+#endif
         }
     }
 }
 
+#if USE_GLYPH_CACHE
+
+/**
+ * Free the alpha mask of a glyph cache entry
+ * @param entry pointer to a cache entry
+ */
+static void glyph_cache_evict(glyph_cache_entry_t * entry)
+{
+    if(entry->data == NULL) return;
+
+    lv_mem_free(entry->data);
+    glyph_cache_used -= entry->size;
+    entry->data = NULL;
+}
+
+/**
+ * Get the decoded alpha mask of a letter. Decode and cache it if it's not cached yet.
+ * @param font_p pointer to font
+ * @param letter a letter
+ * @param opa opacity of letter. It's applied to the alpha mask
+ * @param map_p pointer to the bitmap of the letter
+ * @param letter_w real width of the letter
+ * @param letter_h height of the letter
+ * @param bpp bit per pixel of the bitmap
+ * @param bpp_opa_table opacity mapping of the bitmap values. NULL with 8 bpp
+ * @param mask_init mask of the first pixel in a byte
+ * @return pointer to the cache entry or NULL if it can't be cached
+ */
+static const glyph_cache_entry_t * glyph_cache_get(const lv_font_t * font_p, uint32_t letter, lv_opa_t opa,
+                                                   const uint8_t * map_p, uint8_t letter_w, uint8_t letter_h,
+                                                   uint8_t bpp, const uint8_t * bpp_opa_table, uint8_t mask_init)
+{
+    uint32_t hash = (letter ^ ((uint32_t)font_p >> 2) ^ ((uint32_t)opa << 16)) * 2654435761u;
+    glyph_cache_entry_t * set = glyph_cache[hash >> 25 & (GLYPH_CACHE_SETS - 1)];
+    glyph_cache_entry_t * victim = &set[0];
+    uint8_t i;
+
+    glyph_cache_tick++;
+
+    for(i = 0; i < GLYPH_CACHE_WAYS; i++) {
+        glyph_cache_entry_t * entry = &set[i];
+        if(entry->data && entry->letter == letter && entry->font == font_p && entry->opa == opa) {
+            entry->last_use = glyph_cache_tick;
+            return entry;
+        }
+
+        /*Replace an empty or the least recently used entry of the set*/
+        if(victim->data && (!entry->data || entry->last_use < victim->last_use)) victim = entry;
+    }
+
+    uint32_t size = letter_h * 2 + letter_w * letter_h;
+    if(letter_w == 0 || size > LV_GLYPH_CACHE_SIZE || size > UINT16_MAX) return NULL;
+
+    glyph_cache_evict(victim);
+
+    /*Keep the cache in budget by evicting the least recently used entries*/
+    while(glyph_cache_used + size > LV_GLYPH_CACHE_SIZE) {
+        glyph_cache_entry_t * lru = NULL;
+        glyph_cache_entry_t * entry = &glyph_cache[0][0];
+        uint32_t e;
+        for(e = 0; e < GLYPH_CACHE_SETS * GLYPH_CACHE_WAYS; e++, entry++) {
+            if(entry->data && (lru == NULL || entry->last_use < lru->last_use)) lru = entry;
+        }
+        glyph_cache_evict(lru);
+    }
+
+    uint8_t * data = lv_mem_alloc(size);
+    if(data == NULL) return NULL;
+
+    /*Decode the bitmap to 8 bit alpha and find the span of each row*/
+    uint8_t width_byte_bpp = (letter_w * bpp + 7) >> 3;
+    uint8_t * span_p = data;
+    uint8_t * alpha_p = data + letter_h * 2;
+    uint8_t row, col;
+    for(row = 0; row < letter_h; row++) {
+        const uint8_t * byte_p = map_p;
+        uint8_t col_bit = 0;
+        uint8_t mask = mask_init;
+        uint8_t span_start = letter_w;
+        uint8_t span_end = 0;
+
+        for(col = 0; col < letter_w; col++) {
+            uint8_t letter_px = (*byte_p & mask) >> (8 - col_bit - bpp);
+            lv_opa_t px_opa = bpp == 8 ? letter_px : bpp_opa_table[letter_px];
+            if(opa != LV_OPA_COVER) px_opa = (uint16_t)((uint16_t)px_opa * opa) >> 8;
+
+            alpha_p[col] = px_opa;
+            if(px_opa != LV_OPA_TRANSP) {
+                if(col < span_start) span_start = col;
+                span_end = col + 1;
+            }
+
+            if(col_bit < 8 - bpp) {
+                col_bit += bpp;
+                mask = mask >> bpp;
+            } else {
+                col_bit = 0;
+                mask = mask_init;
+                byte_p++;
+            }
+        }
+
+        if(span_start > span_end) span_start = span_end;
+        span_p[row * 2] = span_start;
+        span_p[row * 2 + 1] = span_end;
+
+        map_p += width_byte_bpp;
+        alpha_p += letter_w;
+    }
+
+    victim->font = font_p;
+    victim->letter = letter;
+    victim->opa = opa;
+    victim->w = letter_w;
+    victim->size = size;
+    victim->data = data;
+    victim->last_use = glyph_cache_tick;
+    glyph_cache_used += size;
+
+    return victim;
+}
+
+#endif /*USE_GLYPH_CACHE*/
+
 #if LV_COLOR_SCREEN_TRANSP
 
 /**
@@ -358,8 +358,14 @@ static inline lv_color_t lv_color_mix(const lv_color_t c1, const lv_color_t c2,
     ret.blue =  (uint16_t)((uint16_t) c1.blue * mix + (c2.blue * (255 - mix))) >> 8;
 #else
 #   if LV_COLOR_DEPTH == 32
-    uint32_t rb = (((c1.full & 0x00FF00FF) * mix) + ((c2.full & 0x00FF00FF) * (255 - mix))) >> 8;
-    uint32_t g = (((((c1.full & 0x0000FF00) >> 8) * mix) + (((c2.full & 0x0000FF00) >> 8) * (255 - mix))) >> 8) << 8;
+    /* c1 * mix + c2 * (255 - mix) == (c2 << 8) - c2 + (c1 - c2) * mix, so one multiply per packed lane pair.
+     * Lanes can borrow in between, but every final lane fits in 16 bits so the result is exact.*/
+    uint32_t c1_rb = c1.full & 0x00FF00FF;
+    uint32_t c2_rb = c2.full & 0x00FF00FF;
+    uint32_t c1_g  = c1.full & 0x0000FF00;
+    uint32_t c2_g  = c2.full & 0x0000FF00;
+    uint32_t rb = ((c2_rb << 8) - c2_rb + (c1_rb - c2_rb) * mix) >> 8;
+    uint32_t g  = ((c2_g << 8) - c2_g + (c1_g - c2_g) * mix) >> 8;
     ret.full = 0xFF000000 | (0x00FF00FF & rb) | (0x0000FF00 & g);
 #   else
     /*LV_COLOR_DEPTH == 1*/
@@ -26,6 +26,7 @@
 #include "lv_mem.h"
 #include "lv_math.h"
 #include <string.h>
+#include <stdbool.h>
 
 #include <assert.h>
 
@@ -38,6 +39,12 @@
  *********************/
 #define LV_MEM_ADD_JUNK     0   /*Add memory junk on alloc (0xaa) and free(0xbb) (just for testing purposes)*/
 
+/*Small allocations are served from per size pools, carved in slabs from the work memory.
+ *That keeps widget nodes away from big buffers and avoids walking all entries for them.*/
+#define LV_MEM_POOL_CLASSES     8           /*Pooled data sizes: 32, 64, ... 256 bytes*/
+#define LV_MEM_POOL_SLAB_ENTS   32          /*Entries carved per slab*/
+#define LV_MEM_POOL_MAGIC       0x4C4F4F50  /*"POOL"*/
+
 
 #ifdef LV_MEM_ENV64
 # define MEM_UNIT uint64_t
@@ -78,6 +85,8 @@ typedef struct {
 static lv_mem_ent_t  * ent_get_next(lv_mem_ent_t * act_e);
 static void * ent_alloc(lv_mem_ent_t * e, uint32_t size);
 static void ent_trunc(lv_mem_ent_t * e, uint32_t size);
+static void * pool_alloc(uint32_t size);
+static bool pool_free(lv_mem_ent_t * e);
 #endif
 
 /**********************
@@ -85,6 +94,7 @@ static void ent_trunc(lv_mem_ent_t * e, uint32_t size);
  **********************/
 #if LV_MEM_CUSTOM == 0
 static uint8_t * work_mem;
+static lv_mem_ent_t * pool_free_ents[LV_MEM_POOL_CLASSES];
 #endif
 
 static uint32_t zero_mem;       /*Give the address of this variable if 0 byte should be allocated*/
@@ -116,6 +126,8 @@ void lv_mem_init(void)
     full->header.used = 0;
     /*The total mem size id reduced by the first header and the close patterns */
     full->header.d_size = LV_MEM_SIZE - sizeof(lv_mem_header_t);
+
+    memset(pool_free_ents, 0, sizeof(pool_free_ents));
 #endif
 }
 
@@ -141,6 +153,10 @@ void * lv_mem_alloc(uint32_t size)
 #if LV_MEM_CUSTOM == 0 /*Use the allocation from dyn_mem*/
     lv_mem_ent_t * e = NULL;
 
+    /*Try the pools first for small sizes*/
+    alloc = pool_alloc(size);
+    if(alloc != NULL) return alloc;
+
     //Search for a appropriate entry
     do {
         //Get the next entry
@@ -198,6 +214,9 @@ void lv_mem_free(const void * data)
 #endif
 
 #if LV_MEM_CUSTOM == 0
+    /*Pooled entries go back to their pool*/
+    if(pool_free(e)) return;
+
 #if LV_MEM_AUTO_DEFRAG
     /* Make a simple defrag.
      * Join the following free entries after this*/
@@ -255,6 +274,10 @@ void * lv_mem_realloc(void * data_p, uint32_t new_size)
      * If the 'old_size' was extended by a header size in 'ent_trunc' it avoids reallocating this same memory */
     if(new_size < old_size) {
         lv_mem_ent_t * e = (lv_mem_ent_t *)((uint8_t *) data_p - sizeof(lv_mem_header_t));
+
+        /*Pooled entries keep their size*/
+        if(e->header.align[1] == LV_MEM_POOL_MAGIC) return data_p;
+
         ent_trunc(e, new_size);
         return &e->first_data;
     }
@@ -435,6 +458,7 @@ static void * ent_alloc(lv_mem_ent_t * e, uint32_t size)
         ent_trunc(e, size),
 
                   e->header.used = 1;
+        e->header.align[1] = 0; /*Not pooled*/
 
         /*Save the allocated data*/
         alloc = &e->first_data;
@@ -467,4 +491,61 @@ static void ent_trunc(lv_mem_ent_t * e, uint32_t size)
     e->header.d_size = size;
 }
 
+/**
+ * Allocate from the pool of the size class. Carve a new slab if the pool is empty.
+ * @param size size rounded to lv_mem_header_t
+ * @return pointer to the allocated memory or NULL if not a pooled size or out of memory
+ */
+static void * pool_alloc(uint32_t size)
+{
+    uint32_t cls = size / sizeof(lv_mem_header_t) - 1;
+    if(cls >= LV_MEM_POOL_CLASSES) return NULL;
+
+    if(pool_free_ents[cls] == NULL) {
+        uint32_t ent_size = sizeof(lv_mem_header_t) + size;
+        uint32_t slab_size = ent_size * LV_MEM_POOL_SLAB_ENTS;
+
+        /*Carve the slab from the work memory. It's never freed*/
+        uint8_t * slab = NULL;
+        lv_mem_ent_t * e = NULL;
+        do {
+            e = ent_get_next(e);
+            if(e != NULL) slab = ent_alloc(e, slab_size);
+        } while(e != NULL && slab == NULL);
+
+        if(slab == NULL) return NULL;
+
+        for(int32_t i = LV_MEM_POOL_SLAB_ENTS - 1; i >= 0; i--) {
+            lv_mem_ent_t * pe = (lv_mem_ent_t *)&slab[ent_size * i];
+            pe->header.header = 0;
+            pe->header.d_size = size;
+            pe->header.align[1] = LV_MEM_POOL_MAGIC;
+            *(lv_mem_ent_t **)&pe->first_data = pool_free_ents[cls];
+            pool_free_ents[cls] = pe;
+        }
+    }
+
+    lv_mem_ent_t * e = pool_free_ents[cls];
+    pool_free_ents[cls] = *(lv_mem_ent_t **)&e->first_data;
+    e->header.used = 1;
+
+    return &e->first_data;
+}
+
+/**
+ * Return a pooled entry to its pool
+ * @param e pointer to an entry
+ * @return true if the entry was pooled
+ */
+static bool pool_free(lv_mem_ent_t * e)
+{
+    if(e->header.align[1] != LV_MEM_POOL_MAGIC) return false;
+
+    uint32_t cls = e->header.d_size / sizeof(lv_mem_header_t) - 1;
+    *(lv_mem_ent_t **)&e->first_data = pool_free_ents[cls];
+    pool_free_ents[cls] = e;
+
+    return true;
+}
+
 #endif
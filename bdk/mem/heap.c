@@ -19,15 +19,98 @@
 #include "heap.h"
 #include <gfx_utils.h>
 
+#define HEAP_BINS_SIZE ALIGN(sizeof(hbins_t), sizeof(hnode_t))
+
 static void _heap_create(heap_t *heap, u32 start)
 {
 	heap->start = start;
 	heap->first = NULL;
+
+	memset((void *)start, 0, sizeof(hbins_t));
+}
+
+static inline hbins_t *_heap_bins(heap_t *heap)
+{
+	return (hbins_t *)heap->start;
+}
+
+// Size class 0 is below 64B and class N covers [32B << N, 64B << N).
+static u32 _heap_bin_idx(u32 size)
+{
+	u32 idx = 0;
+	size >>= 6;
+	while (size)
+	{
+		size >>= 1;
+		idx++;
+	}
+
+	return idx;
+}
+
+static void _heap_bin_insert(hbins_t *hbins, hnode_t *node)
+{
+	u32 idx = _heap_bin_idx(node->size);
+
+	node->bin_prev = NULL;
+	node->bin_next = hbins->bins[idx];
+	if (node->bin_next)
+		node->bin_next->bin_prev = node;
+	hbins->bins[idx] = node;
+	hbins->map |= BIT(idx);
+}
+
+static void _heap_bin_remove(hbins_t *hbins, hnode_t *node)
+{
+	u32 idx = _heap_bin_idx(node->size);
+
+	if (node->bin_prev)
+		node->bin_prev->bin_next = node->bin_next;
+	else
+		hbins->bins[idx] = node->bin_next;
+
+	if (node->bin_next)
+		node->bin_next->bin_prev = node->bin_prev;
+
+	if (!hbins->bins[idx])
+		hbins->map &= ~BIT(idx);
+}
+
+static hnode_t *_heap_bin_find(hbins_t *hbins, u32 size)
+{
+	hnode_t *best = NULL;
+	u32 idx = _heap_bin_idx(size);
+
+	// Best fit inside the size class.
+	for (hnode_t *node = hbins->bins[idx]; node; node = node->bin_next)
+	{
+		if (node->size >= size && (!best || node->size < best->size))
+		{
+			best = node;
+			if (node->size == size)
+				break;
+		}
+	}
+
+	if (best)
+		return best;
+
+	// Any node from the next non-empty size class fits.
+	u32 map = hbins->map & ~(BIT(idx + 1) - 1);
+	if (!map)
+		return NULL;
+
+	idx = 0;
+	while (!(map & BIT(idx)))
+		idx++;
+
+	return hbins->bins[idx];
 }
 
 // Node info is before node address.
 static u32 _heap_alloc(heap_t *heap, u32 size)
 {
+	hbins_t *hbins = _heap_bins(heap);
 	hnode_t *node, *new_node;
 
 	// Align to cache line size.
@@ -35,88 +118,117 @@ static u32 _heap_alloc(heap_t *heap, u32 size)
 
 	if (!heap->first)
 	{
-		node = (hnode_t *)heap->start;
+		node = (hnode_t *)(heap->start + HEAP_BINS_SIZE);
 		node->used = 1;
 		node->size = size;
 		node->prev = NULL;
 		node->next = NULL;
 		heap->first = node;
+		hbins->last = node;
 
 		return (u32)node + sizeof(hnode_t);
 	}
 
-	node = heap->first;
-	while (true)
+	// Check if there's available unused node.
+	node = _heap_bin_find(hbins, size);
+	if (node)
 	{
-		// Check if there's available unused node.
-		if (!node->used && (size <= node->size))
+		_heap_bin_remove(hbins, node);
+
+		// Size and offset of the new unused node.
+		u32 new_size = node->size - size;
+		new_node = (hnode_t *)((u32)node + sizeof(hnode_t) + size);
+
+		// If there's aligned unused space from the old node,
+		// create a new one and set the leftover size.
+		if (new_size >= (sizeof(hnode_t) << 2))
 		{
-			// Size and offset of the new unused node.
-			u32 new_size = node->size - size;
-			new_node = (hnode_t *)((u32)node + sizeof(hnode_t) + size);
-
-			// If there's aligned unused space from the old node,
-			// create a new one and set the leftover size.
-			if (new_size >= (sizeof(hnode_t) << 2))
-			{
-				new_node->size = new_size - sizeof(hnode_t);
-				new_node->used = 0;
-				new_node->next = node->next;
-
-				// Check that we are not on first node.
-				if (new_node->next)
-					new_node->next->prev = new_node;
-
-				new_node->prev = node;
-				node->next = new_node;
-			}
-			else // Unused node size is just enough.
-				size += new_size;
-
-			node->size = size;
-			node->used = 1;
-
-			return (u32)node + sizeof(hnode_t);
+			new_node->size = new_size - sizeof(hnode_t);
+			new_node->used = 0;
+			new_node->next = node->next;
+
+			// Check that we are not on last node.
+			if (new_node->next)
+				new_node->next->prev = new_node;
+			else
+				hbins->last = new_node;
+
+			new_node->prev = node;
+			node->next = new_node;
+
+			_heap_bin_insert(hbins, new_node);
 		}
+		else // Unused node size is just enough.
+			size += new_size;
 
-		// No unused node found, try the next one.
-		if (node->next)
-			node = node->next;
-		else
-			break;
+		node->size = size;
+		node->used = 1;
+
+		return (u32)node + sizeof(hnode_t);
+	}
+
+	// No unused node found. Grow last node if unused, otherwise create a new one.
+	node = hbins->last;
+	if (!node->used)
+	{
+		_heap_bin_remove(hbins, node);
+		node->size = size;
+		node->used = 1;
+
+		return (u32)node + sizeof(hnode_t);
 	}
 
-	// No unused node found, create a new one.
 	new_node = (hnode_t *)((u32)node + sizeof(hnode_t) + node->size);
 	new_node->used = 1;
 	new_node->size = size;
 	new_node->prev = node;
 	new_node->next = NULL;
 	node->next = new_node;
+	hbins->last = new_node;
 
 	return (u32)new_node + sizeof(hnode_t);
 }
 
 static void _heap_free(heap_t *heap, u32 addr)
 {
+	hbins_t *hbins = _heap_bins(heap);
 	hnode_t *node = (hnode_t *)(addr - sizeof(hnode_t));
+
+	if (!node->used)
+		return;
 	node->used = 0;
-	node = heap->first;
-	while (node)
+
+	// Merge with next node if unused.
+	hnode_t *next = node->next;
+	if (next && !next->used)
 	{
-		if (!node->used)
-		{
-			if (node->prev && !node->prev->used)
-			{
-				node->prev->size += node->size + sizeof(hnode_t);
-				node->prev->next = node->next;
-
-				if (node->next)
-					node->next->prev = node->prev;
-			}
-		}
-		node = node->next;
+		_heap_bin_remove(hbins, next);
+		node->size += next->size + sizeof(hnode_t);
+		node->next = next->next;
+
+		if (node->next)
+			node->next->prev = node;
+		else
+			hbins->last = node;
+	}
+
+	// Merge with previous node if unused.
+	hnode_t *prev = node->prev;
+	if (prev && !prev->used)
+	{
+		_heap_bin_remove(hbins, prev);
+		prev->size += node->size + sizeof(hnode_t);
+		prev->next = node->next;
+
+		if (prev->next)
+			prev->next->prev = prev;
+		else
+			hbins->last = prev;
+
+		node = prev;
 	}
+
+	_heap_bin_insert(hbins, node);
 }
 
 heap_t _heap;
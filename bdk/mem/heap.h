@@ -20,15 +20,27 @@
 
 #include <utils/types.h>
 
+#define HEAP_BINS 27 // Size classes from below 64B up to 4GB.
+
 typedef struct _hnode
 {
 	int used;
 	u32 size;
-	struct _hnode *prev;
-	struct _hnode *next;
-	u32 align[4]; // Align to arch cache line size.
+	struct _hnode *prev;      // Previous node in memory.
+	struct _hnode *next;      // Next node in memory.
+	struct _hnode *bin_prev;  // Previous unused node in the same size class.
+	struct _hnode *bin_next;  // Next unused node in the same size class.
+	u32 align[2]; // Align to arch cache line size.
 } hnode_t;
 
+// Kept at heap start, so heap copies in modules stay in sync.
+typedef struct _hbins
+{
+	u32 map; // Size classes that have unused nodes.
+	hnode_t *last;
+	hnode_t *bins[HEAP_BINS];
+} hbins_t;
+
 typedef struct _heap
 {
 	u32 start;
@@ -52,9 +52,15 @@
 #define  RAM_DISK_SZ  0x41000000 // 1040MB.
 #define  RAM_DISK2_SZ 0x21000000 //  528MB.
 
+// UMS write-back cache. Shares the virtual disk area.
+#define UMS_CACHE_ADDR     RAM_DISK_ADDR
+#define  UMS_CACHE_SZ_MAX   0x8000000 // 128MB.
+#define UMS_RA_ADDR        (UMS_CACHE_ADDR + UMS_CACHE_SZ_MAX)
+#define  UMS_RA_SZ          0x1000000 // 16MB.
+
 // NX BIS driver sector cache.
 #define NX_BIS_CACHE_ADDR  0xC5000000
-#define  NX_BIS_CACHE_SZ   0x10020000 // 256MB.
+#define  NX_BIS_CACHE_SZ   0x10080000 // 256MB + header.
 #define NX_BIS_LOOKUP_ADDR 0xD6000000
 #define  NX_BIS_LOOKUP_SZ   0xF000000 // 240MB.
 
@@ -257,7 +257,7 @@ int se_aes_unwrap_key(u32 ks_dst, u32 ks_src, const void *input)
 	return _se_execute_oneshot(SE_OP_START, NULL, 0, input, SE_KEY_128_SIZE);
 }
 
-int se_aes_crypt_ecb(u32 ks, u32 enc, void *dst, u32 dst_size, const void *src, u32 src_size)
+static void _se_aes_ecb_config(u32 ks, u32 enc, u32 src_size)
 {
 	if (enc)
 	{
@@ -270,9 +270,26 @@ int se_aes_crypt_ecb(u32 ks, u32 enc, void *dst, u32 dst_size, const void *src,
 		SE(SE_CRYPTO_CONFIG_REG) = SE_CRYPTO_KEY_INDEX(ks) | SE_CRYPTO_CORE_SEL(CORE_DECRYPT);
 	}
 	SE(SE_CRYPTO_BLOCK_COUNT_REG) = (src_size >> 4) - 1;
+}
+
+int se_aes_crypt_ecb(u32 ks, u32 enc, void *dst, u32 dst_size, const void *src, u32 src_size)
+{
+	_se_aes_ecb_config(ks, enc, src_size);
 	return _se_execute_oneshot(SE_OP_START, dst, dst_size, src, src_size);
 }
 
+int se_aes_crypt_ecb_async(u32 ks, u32 enc, void *dst, u32 dst_size, const void *src, u32 src_size)
+{
+	// Buffers must not be accessed until se_aes_crypt_finalize() is called.
+	_se_aes_ecb_config(ks, enc, src_size);
+	return _se_execute(SE_OP_START, dst, dst_size, src, src_size, false);
+}
+
+int se_aes_crypt_finalize()
+{
+	return _se_execute_finalize();
+}
+
 int se_aes_crypt_cbc(u32 ks, u32 enc, void *dst, u32 dst_size, const void *src, u32 src_size)
 {
 	if (enc)
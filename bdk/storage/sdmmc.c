@@ -139,33 +139,135 @@ static int _sdmmc_storage_check_status(sdmmc_storage_t *storage)
 	return _sdmmc_storage_get_status(storage, &tmp, 0);
 }
 
-static int _sdmmc_storage_readwrite_ex(sdmmc_storage_t *storage, u32 *blkcnt_out, u32 sector, u32 num_sectors, void *buf, u32 is_write)
+static int _sdmmc_storage_req_start(sdmmc_storage_t *storage)
 {
-	u32 tmp = 0;
+	sdmmc_storage_req_t *req = storage->req;
 	sdmmc_cmd_t cmdbuf;
 	sdmmc_req_t reqbuf;
 
+	u32 sector = req->sector + req->done;
+	req->blkcnt = MIN(req->num_sectors - req->done, 0xFFFF);
+
 	// If SDSC convert block address to byte address.
 	if (!storage->has_sector_access)
 		sector <<= 9;
 
-	sdmmc_init_cmd(&cmdbuf, is_write ? MMC_WRITE_MULTIPLE_BLOCK : MMC_READ_MULTIPLE_BLOCK, sector, SDMMC_RSP_TYPE_1, 0);
+	sdmmc_init_cmd(&cmdbuf, req->is_write ? MMC_WRITE_MULTIPLE_BLOCK : MMC_READ_MULTIPLE_BLOCK, sector, SDMMC_RSP_TYPE_1, 0);
 
-	reqbuf.buf = buf;
-	reqbuf.num_sectors = num_sectors;
+	reqbuf.buf = (u8 *)req->buf + (req->done << 9);
+	reqbuf.num_sectors = req->blkcnt;
 	reqbuf.blksize = 512;
-	reqbuf.is_write = is_write;
+	reqbuf.is_write = req->is_write;
 	reqbuf.is_multi_block = 1;
 	reqbuf.is_auto_stop_trn = 1;
 
-	if (!sdmmc_execute_cmd(storage->sdmmc, &cmdbuf, &reqbuf, blkcnt_out))
+	return sdmmc_execute_cmd_async(storage->sdmmc, &cmdbuf, &reqbuf, NULL);
+}
+
+int sdmmc_storage_submit(sdmmc_storage_t *storage, sdmmc_storage_req_t *req)
+{
+	// Exit if not initialized, busy or buffer is not DMA capable.
+	if (!storage->initialized || storage->req || !req->num_sectors ||
+		((u32)req->buf < DRAM_START) || ((u32)req->buf % 8))
+		return 0;
+
+	req->done = 0;
+	req->result = SDMMC_ASYNC_BUSY;
+	storage->req = req;
+
+	if (!_sdmmc_storage_req_start(storage))
+	{
+		storage->req = NULL;
+		return 0;
+	}
+
+	return 1;
+}
+
+int sdmmc_storage_poll(sdmmc_storage_t *storage)
+{
+	u32 tmp = 0;
+	sdmmc_storage_req_t *req = storage->req;
+
+	if (!req)
+		return SDMMC_ASYNC_ERROR;
+
+	int res = sdmmc_execute_cmd_async_poll(storage->sdmmc);
+	if (res == SDMMC_ASYNC_BUSY)
+		return res;
+
+	if (res == SDMMC_ASYNC_DONE)
+	{
+		// Start next segment if any.
+		req->done += req->blkcnt;
+		if (req->done < req->num_sectors)
+			res = _sdmmc_storage_req_start(storage) ? SDMMC_ASYNC_BUSY : SDMMC_ASYNC_ERROR;
+	}
+	else
 	{
 		sdmmc_stop_transmission(storage->sdmmc, &tmp);
 		_sdmmc_storage_get_status(storage, &tmp, 0);
 
+		// Retry segment.
+		if (req->retries)
+		{
+			req->retries--;
+			res = _sdmmc_storage_req_start(storage) ? SDMMC_ASYNC_BUSY : SDMMC_ASYNC_ERROR;
+		}
+	}
+
+	if (res == SDMMC_ASYNC_BUSY)
+		return res;
+
+	// Request completed.
+	storage->req = NULL;
+	req->result = res;
+	if (req->complete)
+		req->complete(req, res);
+
+	return res;
+}
+
+int sdmmc_storage_wait(sdmmc_storage_t *storage)
+{
+	int res;
+	do
+	{
+		res = sdmmc_storage_poll(storage);
+	} while (res == SDMMC_ASYNC_BUSY);
+
+	return res;
+}
+
+static int _sdmmc_storage_readwrite_ex(sdmmc_storage_t *storage, u32 *blkcnt_out, u32 sector, u32 num_sectors, void *buf, u32 is_write)
+{
+	sdmmc_storage_req_t req;
+
+	// Complete any outstanding request first. Its callback gets the result.
+	if (storage->req)
+		sdmmc_storage_wait(storage);
+
+	req.sector = sector;
+	req.num_sectors = num_sectors;
+	req.buf = buf;
+	req.is_write = is_write;
+	req.retries = 0;
+	req.complete = NULL;
+
+	if (!sdmmc_storage_submit(storage, &req))
+	{
+		u32 tmp = 0;
+		sdmmc_stop_transmission(storage->sdmmc, &tmp);
+		_sdmmc_storage_get_status(storage, &tmp, 0);
+
 		return 0;
 	}
 
+	if (sdmmc_storage_wait(storage) != SDMMC_ASYNC_DONE)
+		return 0;
+
+	*blkcnt_out = req.done;
+
 	return 1;
 }
 
@@ -181,6 +283,16 @@ int sdmmc_storage_end(sdmmc_storage_t *storage)
 	return 1;
 }
 
+static void _sdmmc_storage_stats_xfer(sdmmc_storage_t *storage, u32 start_us)
+{
+	u32 ms = (get_tmr_us() - start_us) / 1000;
+	u32 bucket = ms ? (32 - __builtin_clz(ms)) : 0;
+
+	storage->stats.xfers++;
+	storage->stats.clean++;
+	storage->stats.lat[MIN(bucket, SDMMC_LAT_BUCKETS - 1)]++;
+}
+
 static int _sdmmc_storage_readwrite(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf, u32 is_write)
 {
 	u8 *bbuf = (u8 *)buf;
@@ -197,19 +309,33 @@ static int _sdmmc_storage_readwrite(sdmmc_storage_t *storage, u32 sector, u32 nu
 		u32 blkcnt = 0;
 		// Retry 5 times if failed.
 		u32 retries = 5;
+		u32 backoff = 5;
 		do
 		{
-reinit_try:
+reinit_try:;
+			u32 start_us = get_tmr_us();
 			if (_sdmmc_storage_readwrite_ex(storage, &blkcnt, sct_off, MIN(sct_total, 0xFFFF), bbuf, is_write))
+			{
+				_sdmmc_storage_stats_xfer(storage, start_us);
 				goto out;
+			}
 			else
 				retries--;
 
+			storage->stats.retries++;
+			storage->stats.clean = 0;
 			sd_error_count_increment(SD_ERROR_RW_RETRY);
 
-			msleep(50);
+			// Exponential backoff. 5, 10, 20, 40ms.
+			if (retries)
+			{
+				msleep(backoff);
+				backoff <<= 1;
+			}
 		} while (retries);
 
+		storage->stats.fails++;
+
 		// Disk IO failure! Reinit SD Card to a lower speed.
 		if (storage->sdmmc->id == SDMMC_1)
 		{
@@ -229,14 +355,13 @@ reinit_try:
 			// Reset values for a retry.
 			blkcnt = 0;
 			retries = 3;
+			backoff = 5;
 			first_reinit = false;
 
-			// If succesful reinit, restart xfer.
+			// If succesful reinit, retry only the failed extent. Completed ones are kept.
 			if (res)
 			{
-				bbuf = (u8 *)buf;
-				sct_off = sector;
-				sct_total = num_sectors;
+				storage->stats.reinits++;
 
 				goto reinit_try;
 			}
@@ -413,6 +538,9 @@ static void _mmc_storage_parse_ext_csd(sdmmc_storage_t *storage, u8 *buf)
 	storage->ext_csd.dev_version = *(u16 *)&buf[EXT_CSD_DEVICE_VERSION];
 	storage->ext_csd.boot_mult = buf[EXT_CSD_BOOT_MULT];
 	storage->ext_csd.rpmb_mult = buf[EXT_CSD_RPMB_MULT];
+	storage->ext_csd.sec_feature = buf[EXT_CSD_SEC_FEATURE_SUPPORT];
+	storage->ext_csd.erased_mem_cont = buf[EXT_CSD_ERASED_MEM_CONT];
+	storage->ext_csd.trim_mult = buf[EXT_CSD_TRIM_MULT];
 	//storage->ext_csd.bkops = buf[EXT_CSD_BKOPS_SUPPORT];
 	//storage->ext_csd.bkops_en = buf[EXT_CSD_BKOPS_EN];
 	//storage->ext_csd.bkops_status = buf[EXT_CSD_BKOPS_STATUS];
@@ -587,7 +715,7 @@ static int _mmc_storage_enable_bkops(sdmmc_storage_t *storage)
 
 int sdmmc_storage_init_mmc(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_width, u32 type)
 {
-	memset(storage, 0, sizeof(sdmmc_storage_t));
+	memset(storage, 0, OFFSET_OF(sdmmc_storage_t, stats)); // Keep stats across reinits.
 	storage->sdmmc = sdmmc;
 	storage->rca = 2; // Set default device address. This could be a config item.
 
@@ -677,6 +805,35 @@ int sdmmc_storage_set_mmc_partition(sdmmc_storage_t *storage, u32 partition)
 	return 1;
 }
 
+int sdmmc_storage_trim_mmc(sdmmc_storage_t *storage, u32 sector, u32 num_sectors)
+{
+	// Only use TRIM if supported and trimmed sectors read back as zeros.
+	if (!(storage->ext_csd.sec_feature & EXT_CSD_SEC_GB_CL_EN) || storage->ext_csd.erased_mem_cont || !num_sectors)
+		return 0;
+
+	if (!_sdmmc_storage_execute_cmd_type1(storage, MMC_ERASE_GROUP_START, sector, 0, R1_STATE_TRAN))
+		return 0;
+
+	if (!_sdmmc_storage_execute_cmd_type1(storage, MMC_ERASE_GROUP_END, sector + num_sectors - 1, 0, R1_STATE_TRAN))
+		return 0;
+
+	// Busy is polled via status instead, since it can take longer than the data busy timeout.
+	if (!_sdmmc_storage_execute_cmd_type1(storage, MMC_ERASE, MMC_TRIM_ARG, 0, R1_SKIP_STATE_CHECK))
+		return 0;
+
+	// Timeout is 300ms * TRIM_MULT per 512KB group.
+	u32 timeout = get_tmr_ms() + 300 * MAX(storage->ext_csd.trim_mult, 1) * ((num_sectors >> 10) + 1);
+	while (!_sdmmc_storage_check_status(storage))
+	{
+		if (get_tmr_ms() > timeout)
+			return 0;
+
+		usleep(100);
+	}
+
+	return 1;
+}
+
 /*
  * SD specific functions.
  */
@@ -1281,7 +1438,7 @@ DPRINTF("[SD] init: bus: %d, type: %d\n", bus_width, type);
 	// Some cards (SanDisk U1), do not like a fast power cycle. Wait min 100ms.
 	sdmmc_storage_init_wait_sd();
 
-	memset(storage, 0, sizeof(sdmmc_storage_t));
+	memset(storage, 0, OFFSET_OF(sdmmc_storage_t, stats)); // Keep stats across reinits.
 	storage->sdmmc = sdmmc;
 
 	if (!sdmmc_init(sdmmc, SDMMC_1, SDMMC_POWER_3_3, SDMMC_BUS_WIDTH_1, SDHCI_TIMING_SD_ID, SDMMC_POWER_SAVE_DISABLE))
@@ -1425,7 +1582,7 @@ int _gc_storage_custom_cmd(sdmmc_storage_t *storage, void *buf)
 
 int sdmmc_storage_init_gc(sdmmc_storage_t *storage, sdmmc_t *sdmmc)
 {
-	memset(storage, 0, sizeof(sdmmc_storage_t));
+	memset(storage, 0, OFFSET_OF(sdmmc_storage_t, stats)); // Keep stats across reinits.
 	storage->sdmmc = sdmmc;
 
 	if (!sdmmc_init(sdmmc, SDMMC_2, SDMMC_POWER_1_8, SDMMC_BUS_WIDTH_8, SDHCI_TIMING_MMC_HS102, SDMMC_POWER_SAVE_DISABLE))
@@ -76,6 +76,9 @@ typedef struct _mmc_ext_csd
 	u8  dev_life_est_b;
 	u8  boot_mult;
 	u8  rpmb_mult;
+	u8  sec_feature;
+	u8  erased_mem_cont;
+	u8  trim_mult;
 	u16 dev_version;
 	u32 cache_size;
 	u32 max_enh_mult;
@@ -101,6 +104,40 @@ typedef struct _sd_ssr
 	u32 protected_size;
 } sd_ssr_t;
 
+struct _sdmmc_storage_req_t;
+
+/*! SDMMC storage request completion callback. Result is SDMMC_ASYNC_DONE or SDMMC_ASYNC_ERROR. */
+typedef void (*sdmmc_storage_req_cb_t)(struct _sdmmc_storage_req_t *req, int result);
+
+/*! SDMMC storage read/write request. */
+typedef struct _sdmmc_storage_req_t
+{
+	u32   sector;
+	u32   num_sectors;
+	void *buf;
+	u32   is_write;
+	u32   retries;  // Retries per segment before failing.
+	sdmmc_storage_req_cb_t complete;
+	void *priv;
+	// Set by the driver.
+	u32   done;     // Sectors transferred.
+	u32   blkcnt;   // Sectors of current segment.
+	int   result;
+} sdmmc_storage_req_t;
+
+#define SDMMC_LAT_BUCKETS 8
+
+/*! SDMMC storage error and latency statistics. */
+typedef struct _sdmmc_storage_stats_t
+{
+	u32 xfers;   // Successful transfers.
+	u32 retries; // Failed attempts that were retried.
+	u32 fails;   // Transfers that ran out of retries.
+	u32 reinits; // Successful reinits after a failure.
+	u32 clean;   // Transfers since last retry.
+	u32 lat[SDMMC_LAT_BUCKETS]; // Transfer latency. Bucket n: < 2^n ms, last is the rest.
+} sdmmc_storage_stats_t;
+
 /*! SDMMC storage context. */
 typedef struct _sdmmc_storage_t
 {
@@ -120,13 +157,19 @@ typedef struct _sdmmc_storage_t
 	mmc_ext_csd_t ext_csd;
 	sd_scr_t      scr;
 	sd_ssr_t      ssr;
+	sdmmc_storage_req_t *req; // Outstanding request.
+	sdmmc_storage_stats_t stats;
 } sdmmc_storage_t;
 
 int  sdmmc_storage_end(sdmmc_storage_t *storage);
 int  sdmmc_storage_read(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
 int  sdmmc_storage_write(sdmmc_storage_t *storage, u32 sector, u32 num_sectors, void *buf);
+int  sdmmc_storage_submit(sdmmc_storage_t *storage, sdmmc_storage_req_t *req);
+int  sdmmc_storage_poll(sdmmc_storage_t *storage);
+int  sdmmc_storage_wait(sdmmc_storage_t *storage);
 int  sdmmc_storage_init_mmc(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_width, u32 type);
 int  sdmmc_storage_set_mmc_partition(sdmmc_storage_t *storage, u32 partition);
+int  sdmmc_storage_trim_mmc(sdmmc_storage_t *storage, u32 sector, u32 num_sectors);
 void sdmmc_storage_init_wait_sd();
 int  sdmmc_storage_init_sd(sdmmc_storage_t *storage, sdmmc_t *sdmmc, u32 bus_width, u32 type);
 int  sdmmc_storage_init_gc(sdmmc_storage_t *storage, sdmmc_t *sdmmc);
@@ -39,6 +39,17 @@
 #define SDMMC_EMMC_OC
 #endif
 
+/*! SDMMC async request states. */
+#define SDMMC_ASYNC_STATE_IDLE     0
+#define SDMMC_ASYNC_STATE_BUSY     1
+#define SDMMC_ASYNC_STATE_COMPLETE 2
+
+/*! SDMMC controllers with an async request in flight. */
+static sdmmc_t *_sdmmc_async[4] = { NULL };
+static u32 _sdmmc_async_pending = 0;
+
+static void _sdmmc_async_service(sdmmc_t *sdmmc);
+
 /*! SCMMC controller base addresses. */
 static const u32 _sdmmc_bases[4] = {
 	0x700B0000,
@@ -841,6 +852,8 @@ static int _sdmmc_wait_response(sdmmc_t *sdmmc)
 	u32 timeout = get_tmr_ms() + 2000;
 	while (true)
 	{
+		_sdmmc_async_service(sdmmc);
+
 		int result = _sdmmc_check_mask_interrupt(sdmmc, NULL, SDHCI_INT_RESPONSE);
 		if (result == SDMMC_MASKINT_MASKED)
 			break;
@@ -970,7 +983,11 @@ static int _sdmmc_update_dma(sdmmc_t *sdmmc)
 				result = _sdmmc_check_mask_interrupt(sdmmc, &intr,
 					SDHCI_INT_DATA_END | SDHCI_INT_DMA_END);
 				if (result < 0)
+				{
+					// Keep transfers of other controllers going while waiting.
+					_sdmmc_async_service(sdmmc);
 					break;
+				}
 
 				if (intr & SDHCI_INT_DATA_END)
 					return 1; // Transfer complete.
@@ -1098,6 +1115,111 @@ DPRINTF("rsp(%d): %08X, %08X, %08X, %08X\n", result,
 	return result;
 }
 
+static int _sdmmc_async_finalize(sdmmc_t *sdmmc, int result)
+{
+	_sdmmc_mask_interrupts(sdmmc);
+
+	if (result)
+	{
+		// Flush cache after transfer.
+		bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
+
+		if (sdmmc->async_auto_stop_trn)
+			sdmmc->rsp3 = sdmmc->regs->rspreg3;
+
+		result = _sdmmc_wait_card_busy(sdmmc);
+	}
+
+	usleep((8000 + sdmmc->divisor - 1) / sdmmc->divisor);
+
+	if (sdmmc->async_disable_sd_clock)
+		sdmmc->regs->clkcon &= ~SDHCI_CLOCK_CARD_EN;
+
+	sdmmc->async_result = result;
+	sdmmc->async_state = SDMMC_ASYNC_STATE_COMPLETE;
+	_sdmmc_async[sdmmc->id] = NULL;
+	_sdmmc_async_pending--;
+
+	return result;
+}
+
+static void _sdmmc_async_update(sdmmc_t *sdmmc)
+{
+	int result;
+	u16 intr = 0;
+
+	while (true)
+	{
+		result = _sdmmc_check_mask_interrupt(sdmmc, &intr, SDHCI_INT_DATA_END | SDHCI_INT_DMA_END);
+		if (result < 0)
+			break;
+
+		if (intr & SDHCI_INT_DATA_END)
+		{
+			_sdmmc_async_finalize(sdmmc, 1); // Transfer complete.
+			return;
+		}
+
+		if (intr & SDHCI_INT_DMA_END)
+		{
+			// Update DMA.
+			sdmmc->regs->admaaddr = sdmmc->dma_addr_next;
+			sdmmc->regs->admaaddr_hi = 0;
+			sdmmc->dma_addr_next += 0x80000;
+		}
+	}
+
+	if (result != SDMMC_MASKINT_NOERROR)
+	{
+#ifdef ERROR_EXTRA_PRINTING
+		EPRINTFARGS("%08X!", result);
+#endif
+		_sdmmc_reset(sdmmc);
+		_sdmmc_async_finalize(sdmmc, 0);
+		return;
+	}
+
+	// Timeout only if no progress was made.
+	if (get_tmr_ms() > sdmmc->async_timeout)
+	{
+		u16 blkcnt = sdmmc->regs->blkcnt;
+		if (blkcnt == sdmmc->async_blkcnt)
+		{
+#ifdef ERROR_EXTRA_PRINTING
+			EPRINTF("SDMMC: DMA Update failed!");
+#endif
+			_sdmmc_reset(sdmmc);
+			_sdmmc_async_finalize(sdmmc, 0);
+			return;
+		}
+
+		sdmmc->async_blkcnt = blkcnt;
+		sdmmc->async_timeout = get_tmr_ms() + 1500;
+	}
+}
+
+static void _sdmmc_async_service(sdmmc_t *sdmmc)
+{
+	if (!_sdmmc_async_pending)
+		return;
+
+	for (u32 i = 0; i < 4; i++)
+	{
+		sdmmc_t *async_sdmmc = _sdmmc_async[i];
+		if (async_sdmmc && async_sdmmc != sdmmc && async_sdmmc->async_state == SDMMC_ASYNC_STATE_BUSY)
+			_sdmmc_async_update(async_sdmmc);
+	}
+}
+
+static void _sdmmc_async_wait(sdmmc_t *sdmmc)
+{
+	while (sdmmc->async_state == SDMMC_ASYNC_STATE_BUSY)
+	{
+		_sdmmc_async_update(sdmmc);
+		_sdmmc_async_service(sdmmc);
+	}
+}
+
 bool sdmmc_get_sd_inserted()
 {
 	return (!gpio_read(GPIO_PORT_Z, GPIO_PIN_1));
@@ -1376,6 +1498,8 @@ void sdmmc_end(sdmmc_t *sdmmc)
 {
 	if (!sdmmc->clock_stopped)
 	{
+		_sdmmc_async_wait(sdmmc);
+
 		_sdmmc_sd_clock_disable(sdmmc);
 		// Disable SDMMC power.
 		_sdmmc_set_io_power(sdmmc, SDMMC_POWER_OFF);
@@ -1403,6 +1527,9 @@ int sdmmc_execute_cmd(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *b
 	if (!sdmmc->card_clock_enabled)
 		return 0;
 
+	// Finish any async transfer first. Its result is kept for the poller.
+	_sdmmc_async_wait(sdmmc);
+
 	// Recalibrate periodically for SDMMC1.
 	if (sdmmc->manual_cal && sdmmc->powersave_enabled)
 		_sdmmc_autocal_execute(sdmmc, sdmmc_get_io_power(sdmmc));
@@ -1425,6 +1552,102 @@ int sdmmc_execute_cmd(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *b
 	return result;
 }
 
+int sdmmc_execute_cmd_async(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out)
+{
+	u32 blkcnt = 0;
+
+	// Only data transfers can be async and only one per controller.
+	if (!sdmmc->card_clock_enabled || !req || sdmmc->async_state == SDMMC_ASYNC_STATE_BUSY)
+		return 0;
+
+	// Recalibrate periodically for SDMMC1.
+	if (sdmmc->manual_cal && sdmmc->powersave_enabled)
+		_sdmmc_autocal_execute(sdmmc, sdmmc_get_io_power(sdmmc));
+
+	sdmmc->async_disable_sd_clock = 0;
+	if (!(sdmmc->regs->clkcon & SDHCI_CLOCK_CARD_EN))
+	{
+		sdmmc->async_disable_sd_clock = 1;
+		sdmmc->regs->clkcon |= SDHCI_CLOCK_CARD_EN;
+		_sdmmc_commit_changes(sdmmc);
+		usleep((8000 + sdmmc->divisor - 1) / sdmmc->divisor);
+	}
+
+	if (!_sdmmc_wait_cmd_data_inhibit(sdmmc, true))
+		goto error;
+
+	if (!_sdmmc_config_dma(sdmmc, &blkcnt, req))
+	{
+#ifdef ERROR_EXTRA_PRINTING
+		EPRINTF("SDMMC: DMA Wrong cfg!");
+#endif
+		goto error;
+	}
+
+	// Flush cache before starting the transfer.
+	bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
+
+	_sdmmc_enable_interrupts(sdmmc);
+
+	if (!_sdmmc_send_cmd(sdmmc, cmd, true) || !_sdmmc_wait_response(sdmmc))
+	{
+#ifdef ERROR_EXTRA_PRINTING
+		EPRINTF("SDMMC: Transfer timeout!");
+#endif
+		_sdmmc_mask_interrupts(sdmmc);
+		goto error;
+	}
+
+	if (cmd->rsp_type)
+	{
+		sdmmc->expected_rsp_type = cmd->rsp_type;
+		if (!_sdmmc_cache_rsp(sdmmc, sdmmc->rsp, 0x10, cmd->rsp_type))
+		{
+			_sdmmc_reset(sdmmc);
+			_sdmmc_mask_interrupts(sdmmc);
+			goto error;
+		}
+	}
+
+	if (blkcnt_out)
+		*blkcnt_out = blkcnt;
+
+	// Data phase is now in flight. Progress it from poll or any other blocking wait.
+	sdmmc->async_auto_stop_trn = req->is_auto_stop_trn;
+	sdmmc->async_blkcnt = sdmmc->regs->blkcnt;
+	sdmmc->async_timeout = get_tmr_ms() + 1500;
+	sdmmc->async_state = SDMMC_ASYNC_STATE_BUSY;
+	_sdmmc_async[sdmmc->id] = sdmmc;
+	_sdmmc_async_pending++;
+
+	return 1;
+
+error:
+	usleep((8000 + sdmmc->divisor - 1) / sdmmc->divisor);
+
+	if (sdmmc->async_disable_sd_clock)
+		sdmmc->regs->clkcon &= ~SDHCI_CLOCK_CARD_EN;
+
+	return 0;
+}
+
+int sdmmc_execute_cmd_async_poll(sdmmc_t *sdmmc)
+{
+	if (sdmmc->async_state == SDMMC_ASYNC_STATE_BUSY)
+		_sdmmc_async_update(sdmmc);
+
+	switch (sdmmc->async_state)
+	{
+	case SDMMC_ASYNC_STATE_BUSY:
+		return SDMMC_ASYNC_BUSY;
+	case SDMMC_ASYNC_STATE_COMPLETE:
+		sdmmc->async_state = SDMMC_ASYNC_STATE_IDLE;
+		return sdmmc->async_result ? SDMMC_ASYNC_DONE : SDMMC_ASYNC_ERROR;
+	default:
+		return SDMMC_ASYNC_ERROR; // No request.
+	}
+}
+
 int sdmmc_enable_low_voltage(sdmmc_t *sdmmc)
 {
 	if(sdmmc->id != SDMMC_1)
@@ -50,6 +50,11 @@
 #define SDMMC_MASKINT_NOERROR -1
 #define SDMMC_MASKINT_ERROR   -2
 
+/*! SDMMC async transfer status. */
+#define SDMMC_ASYNC_ERROR 0
+#define SDMMC_ASYNC_DONE  1
+#define SDMMC_ASYNC_BUSY -1
+
 /*! SDMMC present state. */
 #define SDHCI_CMD_INHIBIT      0x1
 #define SDHCI_DATA_INHIBIT     0x2
@@ -223,6 +228,12 @@ typedef struct _sdmmc_t
 	u32 rsp[4];
 	u32 rsp3;
 	int t210b01;
+	int async_state;
+	int async_result;
+	int async_auto_stop_trn;
+	int async_disable_sd_clock;
+	u16 async_blkcnt;
+	u32 async_timeout;
 } sdmmc_t;
 
 /*! SDMMC command. */
@@ -259,6 +270,8 @@ int  sdmmc_init(sdmmc_t *sdmmc, u32 id, u32 power, u32 bus_width, u32 type, int
 void sdmmc_end(sdmmc_t *sdmmc);
 void sdmmc_init_cmd(sdmmc_cmd_t *cmdbuf, u16 cmd, u32 arg, u32 rsp_type, u32 check_busy);
 int  sdmmc_execute_cmd(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out);
+int  sdmmc_execute_cmd_async(sdmmc_t *sdmmc, sdmmc_cmd_t *cmd, sdmmc_req_t *req, u32 *blkcnt_out);
+int  sdmmc_execute_cmd_async_poll(sdmmc_t *sdmmc);
 int  sdmmc_enable_low_voltage(sdmmc_t *sdmmc);
 
 #endif
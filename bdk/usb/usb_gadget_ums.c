@@ -37,8 +37,6 @@
 //#define DPRINTF(...) gfx_printf(__VA_ARGS__)
 #define DPRINTF(...)
 
-#define UMS_MAX_LUN 1 // Only 1 disk/partition for now.
-
 #define USB_BULK_CB_WRAP_LEN 31
 #define USB_BULK_CB_SIG      0x43425355 // USBC.
 #define USB_BULK_IN_FLAG     0x80
@@ -59,6 +57,15 @@
 #define UMS_SCSI_TRANSFER_512K (0x80000 >> UMS_DISK_LBA_SHIFT)
 
 #define UMS_EP_OUT_MAX_XFER (USB_EP_BULK_OUT_MAX_XFER)
+#define UMS_EP_POLL_TRIES   1000 // 1ms.
+
+#define UMS_CACHE_MIN_SZ (USB_EP_BUFFER_MAX_SIZE * 2)
+
+#define UMS_RA_ENTRIES    2
+#define UMS_RA_ENTRY_SZ   ((UMS_RA_SZ / UMS_RA_ENTRIES) >> UMS_DISK_LBA_SHIFT)
+#define UMS_RA_MIN_WINDOW (0x40000 >> UMS_DISK_LBA_SHIFT) // 256KB.
+
+#define UMS_IN_VEC_MAX (UMS_RA_ENTRIES + 1) // Read-ahead parts + SDMMC part.
 
 // Length of a SCSI Command Data Block.
 #define SCSI_MAX_CMD_SZ 16
@@ -160,6 +167,19 @@ typedef struct _bulk_send_pkt_t {
 	u8  Status;
 } bulk_send_pkt_t;
 
+typedef struct _ums_cache_t {
+	u8  *buf;
+	sdmmc_storage_t *storage;
+	u32  offset;
+	u32  half_sz; // Sectors per half. One is filled while the other is written.
+	u32  half;    // Active half.
+	u32  lba;     // First sector of the active extent.
+	u32  cnt;     // Sectors in the active extent.
+	bool busy;    // Other half is being written.
+	bool error;   // Deferred write error.
+	sdmmc_storage_req_t req;
+} ums_cache_t;
+
 typedef struct _logical_unit_t
 {
 	sdmmc_t *sdmmc;
@@ -181,6 +201,8 @@ typedef struct _logical_unit_t
 	u32 sense_data;
 	u32 sense_data_info;
 	u32 unit_attention_data;
+
+	ums_cache_t cache;
 } logical_unit_t;
 
 typedef struct _bulk_ctxt_t {
@@ -190,6 +212,8 @@ typedef struct _bulk_ctxt_t {
 	u32  bulk_in_length_actual;
 	u8  *bulk_in_buf;
 	enum buffer_state bulk_in_buf_state;
+	usb_xfer_vec_t bulk_in_vec[UMS_IN_VEC_MAX];
+	u32  bulk_in_vec_cnt; // If set, the vector is sent instead of the buffer.
 
 	u32  bulk_out;
 	int  bulk_out_status;
@@ -200,6 +224,23 @@ typedef struct _bulk_ctxt_t {
 	enum buffer_state bulk_out_buf_state;
 } bulk_ctxt_t;
 
+typedef struct _ums_ra_entry_t {
+	u8  *buf;
+	u32  lba;
+	u32  cnt;  // Sectors. 0: Invalid.
+	bool busy;
+	sdmmc_storage_req_t req;
+} ums_ra_entry_t;
+
+typedef struct _ums_ra_t {
+	logical_unit_t *lun; // LUN of the stream.
+	u32  next;           // Predicted next LBA.
+	bool pending;        // Last read to update the stream with, after it's sent.
+	u32  pending_lba;
+	u32  pending_num;
+	ums_ra_entry_t entry[UMS_RA_ENTRIES];
+} ums_ra_t;
+
 typedef struct _usbd_gadget_ums_t {
 	bulk_ctxt_t bulk_ctxt;
 
@@ -207,7 +248,11 @@ typedef struct _usbd_gadget_ums_t {
 	u8   cmnd[SCSI_MAX_CMD_SZ];
 
 	u32  lun_idx; // lun index
-	logical_unit_t lun;
+	u32  lun_cnt;
+	logical_unit_t *lun; // Current LUN.
+	logical_unit_t luns[UMS_MAX_LUN];
+
+	ums_ra_t ra; // Read-ahead.
 
 	enum ums_state state; // For exception handling.
 
@@ -319,9 +364,18 @@ static void _ums_transfer_start(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt,
 {
 	if (ep == bulk_ctxt->bulk_in)
 	{
-		bulk_ctxt->bulk_in_status = usb_ops.usb_device_ep1_in_write(
-			bulk_ctxt->bulk_in_buf, bulk_ctxt->bulk_in_length,
-			&bulk_ctxt->bulk_in_length_actual, sync_timeout);
+		if (bulk_ctxt->bulk_in_vec_cnt)
+		{
+			// Chained parts. The vector is consumed when queued.
+			bulk_ctxt->bulk_in_status = usb_ops.usb_device_ep1_in_writev(
+				bulk_ctxt->bulk_in_vec, bulk_ctxt->bulk_in_vec_cnt,
+				&bulk_ctxt->bulk_in_length_actual, sync_timeout);
+			bulk_ctxt->bulk_in_vec_cnt = 0;
+		}
+		else
+			bulk_ctxt->bulk_in_status = usb_ops.usb_device_ep1_in_write(
+				bulk_ctxt->bulk_in_buf, bulk_ctxt->bulk_in_length,
+				&bulk_ctxt->bulk_in_length_actual, sync_timeout);
 
 		if (bulk_ctxt->bulk_in_status == USB_ERROR_XFER_ERROR)
 		{
@@ -401,11 +455,378 @@ static void _ums_transfer_finish(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt,
 static void _ums_reset_buffer(bulk_ctxt_t *bulk_ctxt, u32 ep)
 {
 	if (ep == bulk_ctxt->bulk_in)
+	{
 		bulk_ctxt->bulk_in_buf  = (u8 *)USB_EP_BULK_IN_BUF_ADDR;
+		bulk_ctxt->bulk_in_vec_cnt = 0;
+	}
 	else
 		bulk_ctxt->bulk_out_buf = (u8 *)USB_EP_BULK_OUT_BUF_ADDR;
 }
 
+static u8 *_ums_cache_half_buf(ums_cache_t *cache, u32 half)
+{
+	return cache->buf + half * (cache->half_sz << UMS_DISK_LBA_SHIFT);
+}
+
+static void _ums_cache_wait(ums_cache_t *cache)
+{
+	if (!cache->busy)
+		return;
+
+	cache->busy = false;
+
+	// A synced transfer might have already completed it.
+	if (cache->storage->req == &cache->req)
+		sdmmc_storage_wait(cache->storage);
+
+	if (cache->req.result == SDMMC_ASYNC_DONE)
+		return;
+
+	// Retry synced. That also reinits and lowers speed if needed.
+	if (!sdmmc_storage_write(cache->storage, cache->req.sector, cache->req.num_sectors, cache->req.buf))
+		cache->error = true;
+}
+
+static void _ums_cache_submit(ums_cache_t *cache)
+{
+	if (!cache->cnt)
+		return;
+
+	// Only one half can be in flight.
+	_ums_cache_wait(cache);
+
+	cache->req.sector = cache->offset + cache->lba;
+	cache->req.num_sectors = cache->cnt;
+	cache->req.buf = _ums_cache_half_buf(cache, cache->half);
+	cache->req.is_write = 1;
+	cache->req.retries = 3;
+	cache->req.complete = NULL;
+
+	if (sdmmc_storage_submit(cache->storage, &cache->req))
+		cache->busy = true;
+	else if (!sdmmc_storage_write(cache->storage, cache->req.sector, cache->req.num_sectors, cache->req.buf))
+		cache->error = true;
+
+	// Fill the other half.
+	cache->half ^= 1;
+	cache->cnt = 0;
+}
+
+static void _ums_cache_writeback(ums_cache_t *cache)
+{
+	_ums_cache_submit(cache);
+	_ums_cache_wait(cache);
+}
+
+static int _ums_cache_flush(usbd_gadget_ums_t *ums)
+{
+	ums_cache_t *cache = &ums->lun->cache;
+
+	if (!cache->buf)
+		return 1;
+
+	_ums_cache_writeback(cache);
+
+	if (cache->error)
+	{
+		cache->error = false;
+		ums->set_text(ums->label, "#FFDD00 Error:# SDMMC Write!");
+
+		return 0;
+	}
+
+	return 1;
+}
+
+static bool _ums_cache_overlaps(ums_cache_t *cache, u32 lba, u32 num)
+{
+	return cache->cnt && lba < (cache->lba + cache->cnt) && (lba + num) > cache->lba;
+}
+
+static bool _ums_ra_wait(ums_ra_t *ra, ums_ra_entry_t *entry)
+{
+	if (entry->busy)
+	{
+		entry->busy = false;
+
+		// A synced transfer might have already completed it.
+		if (ra->lun->storage->req == &entry->req)
+			sdmmc_storage_wait(ra->lun->storage);
+
+		if (entry->req.result != SDMMC_ASYNC_DONE)
+			entry->cnt = 0;
+	}
+
+	return entry->cnt != 0;
+}
+
+static void _ums_ra_invalidate(ums_ra_t *ra)
+{
+	for (u32 i = 0; i < UMS_RA_ENTRIES; i++)
+	{
+		_ums_ra_wait(ra, &ra->entry[i]);
+		ra->entry[i].cnt = 0;
+	}
+
+	ra->lun = NULL;
+}
+
+static void _ums_ra_invalidate_range(ums_ra_t *ra, logical_unit_t *lun, u32 lba, u32 num)
+{
+	if (ra->lun != lun)
+		return;
+
+	for (u32 i = 0; i < UMS_RA_ENTRIES; i++)
+	{
+		ums_ra_entry_t *entry = &ra->entry[i];
+		if (entry->cnt && lba < (entry->lba + entry->cnt) && (lba + num) > entry->lba)
+		{
+			_ums_ra_wait(ra, entry);
+			entry->cnt = 0;
+		}
+	}
+}
+
+static u8 *_ums_ra_lookup(ums_ra_t *ra, logical_unit_t *lun, u32 lba, u32 *num)
+{
+	if (ra->lun != lun)
+		return NULL;
+
+	for (u32 i = 0; i < UMS_RA_ENTRIES; i++)
+	{
+		ums_ra_entry_t *entry = &ra->entry[i];
+		if (!entry->cnt || lba < entry->lba || lba >= (entry->lba + entry->cnt))
+			continue;
+
+		// USB needs EP aligned buffers.
+		u32 off = lba - entry->lba;
+		if ((off << UMS_DISK_LBA_SHIFT) % USB_EP_BUFFER_ALIGN)
+			return NULL;
+
+		if (!_ums_ra_wait(ra, entry))
+			return NULL;
+
+		*num = MIN(*num, entry->cnt - off);
+
+		return entry->buf + (off << UMS_DISK_LBA_SHIFT);
+	}
+
+	return NULL;
+}
+
+static u32 _ums_ra_gather(ums_ra_t *ra, logical_unit_t *lun, u32 lba, u32 num, usb_xfer_vec_t *vec, u32 *vec_cnt)
+{
+	u32 cnt = 0;
+
+	// Collect the prefetched parts from the start. Returns the sectors left to read.
+	while (num && cnt < UMS_RA_ENTRIES)
+	{
+		u32 part = num;
+		u8 *buf = _ums_ra_lookup(ra, lun, lba, &part);
+		if (!buf)
+			break;
+
+		vec[cnt].buf = buf;
+		vec[cnt].len = part << UMS_DISK_LBA_SHIFT;
+		cnt++;
+
+		lba += part;
+		num -= part;
+	}
+
+	*vec_cnt = cnt;
+
+	return num;
+}
+
+static void _ums_ra_prefetch(ums_ra_t *ra, logical_unit_t *lun, u32 lba, u32 num)
+{
+	bool sequential = ra->lun == lun && ra->next == lba;
+
+	if (!sequential)
+	{
+		// New stream. Wait for the next one before prefetching.
+		_ums_ra_invalidate(ra);
+		ra->lun = lun;
+		ra->next = lba + num;
+
+		return;
+	}
+
+	ra->next = lba + num;
+
+	// Prefetch after the furthest valid data. Entries fully consumed are free.
+	u32 start = ra->next;
+	ums_ra_entry_t *free_entry = NULL;
+	for (u32 i = 0; i < UMS_RA_ENTRIES; i++)
+	{
+		ums_ra_entry_t *entry = &ra->entry[i];
+		if (entry->busy)
+			return; // One in flight at a time.
+
+		if (entry->cnt && (entry->lba + entry->cnt) > ra->next)
+			start = MAX(start, entry->lba + entry->cnt);
+		else
+			free_entry = entry;
+	}
+
+	if (!free_entry || start >= lun->num_sectors)
+		return;
+
+	// Window adapts to the request size.
+	u32 window = MIN(MAX(num * 4, UMS_RA_MIN_WINDOW), UMS_RA_ENTRY_SZ);
+	window = MIN(window, lun->num_sectors - start);
+
+	// Never prefetch data that is still dirty in cache.
+	if (_ums_cache_overlaps(&lun->cache, start, window))
+		return;
+
+	free_entry->lba = start;
+	free_entry->cnt = window;
+	free_entry->req.sector = lun->offset + start;
+	free_entry->req.num_sectors = window;
+	free_entry->req.buf = free_entry->buf;
+	free_entry->req.is_write = 0;
+	free_entry->req.retries = 1;
+	free_entry->req.complete = NULL;
+
+	// Busy storage is not an error. Just skip.
+	if (sdmmc_storage_submit(lun->storage, &free_entry->req))
+		free_entry->busy = true;
+	else
+		free_entry->cnt = 0;
+}
+
+static void _ums_ra_update(usbd_gadget_ums_t *ums)
+{
+	ums_ra_t *ra = &ums->ra;
+
+	if (!ra->pending)
+		return;
+
+	ra->pending = false;
+	_ums_ra_prefetch(ra, ums->lun, ra->pending_lba, ra->pending_num);
+}
+
+static void _ums_cache_writeback_all(usbd_gadget_ums_t *ums)
+{
+	for (u32 i = 0; i < ums->lun_cnt; i++)
+		_ums_cache_writeback(&ums->luns[i].cache);
+}
+
+static void _ums_cache_wait_all(usbd_gadget_ums_t *ums)
+{
+	for (u32 i = 0; i < ums->lun_cnt; i++)
+		_ums_cache_wait(&ums->luns[i].cache);
+
+	for (u32 i = 0; i < UMS_RA_ENTRIES; i++)
+		_ums_ra_wait(&ums->ra, &ums->ra.entry[i]);
+}
+
+static bool _ums_luns_unmounted(usbd_gadget_ums_t *ums)
+{
+	for (u32 i = 0; i < ums->lun_cnt; i++)
+		if (!ums->luns[i].unmounted)
+			return false;
+
+	return true;
+}
+
+static bool _ums_luns_prevent_removal(usbd_gadget_ums_t *ums)
+{
+	for (u32 i = 0; i < ums->lun_cnt; i++)
+		if (ums->luns[i].prevent_medium_removal)
+			return true;
+
+	return false;
+}
+
+static int _ums_lun_set_partition(usbd_gadget_ums_t *ums)
+{
+	logical_unit_t *lun = ums->lun;
+
+	if (lun->type != MMC_EMMC || lun->storage->partition == (lun->partition - 1))
+		return 1;
+
+	// Read-ahead and cached data of other LUNs on the same storage belong to the current partition.
+	if (ums->ra.lun && ums->ra.lun->storage == lun->storage)
+		_ums_ra_invalidate(&ums->ra);
+
+	for (u32 i = 0; i < ums->lun_cnt; i++)
+		if (ums->luns[i].storage == lun->storage)
+			_ums_cache_writeback(&ums->luns[i].cache);
+
+	return sdmmc_storage_set_mmc_partition(lun->storage, lun->partition - 1);
+}
+
+static void _ums_transfer_out_cached_read(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
+{
+	// Nothing to overlap with.
+	if (!ums->lun->cache.busy)
+	{
+		_ums_transfer_out_big_read(ums, bulk_ctxt);
+		return;
+	}
+
+	u8 *buf = bulk_ctxt->bulk_out_buf;
+	u32 len = bulk_ctxt->bulk_out_length;
+	u32 bytes = 0;
+
+	bulk_ctxt->bulk_out_length_actual = 0;
+
+	// Receive in EP sized parts, or chained ones if supported, and service the SDMMC write in between.
+	while (len)
+	{
+		u32 len_ep = MIN(len, USB_EP_BUFFER_MAX_SIZE);
+
+		if (usb_ops.usb_device_ep1_out_readv)
+		{
+			usb_xfer_vec_t vec;
+			vec.buf = buf;
+			vec.len = len_ep = MIN(len, USB_EP_VEC_MAX_SIZE - ((u32)buf % USB_EP_BUFFER_MAX_SIZE));
+
+			bulk_ctxt->bulk_out_status = usb_ops.usb_device_ep1_out_readv(&vec, 1, NULL, USB_XFER_START);
+			if (bulk_ctxt->bulk_out_status)
+				break;
+
+			// Give up after the same time as a synced data transfer, so EP timeout handling can kick in.
+			u32 timer = get_tmr_ms() + USB_XFER_SYNCED_DATA / 1000;
+			do
+			{
+				sdmmc_storage_poll(ums->lun->cache.storage);
+				bulk_ctxt->bulk_out_status = usb_ops.usb_device_ep1_out_reading_wait(&bytes, UMS_EP_POLL_TRIES);
+			} while (bulk_ctxt->bulk_out_status == USB_ERROR_TIMEOUT && get_tmr_ms() < timer);
+		}
+		else
+		{
+			bulk_ctxt->bulk_out_status = usb_ops.usb_device_ep1_out_read(buf, len_ep, NULL, USB_XFER_START);
+			if (bulk_ctxt->bulk_out_status)
+				break;
+
+			sdmmc_storage_poll(ums->lun->cache.storage);
+
+			bulk_ctxt->bulk_out_status = usb_ops.usb_device_ep1_out_reading_finish(&bytes);
+		}
+		if (bulk_ctxt->bulk_out_status)
+			break;
+
+		bulk_ctxt->bulk_out_length_actual += bytes;
+		if (bytes < len_ep)
+			break;
+
+		len -= len_ep;
+		buf += len_ep;
+	}
+
+	if (bulk_ctxt->bulk_out_status == USB_ERROR_XFER_ERROR)
+	{
+		ums->set_text(ums->label, "#FFDD00 Error:# EP OUT transfer!");
+		ums_flush_endpoint(bulk_ctxt->bulk_out);
+	}
+
+	bulk_ctxt->bulk_out_buf_state = BUF_STATE_FULL;
+}
+
 /*
  * The following are old data based on max 64KB SCSI transfers.
  * The endpoint xfer is actually 41.2 MB/s and SD card max 39.2 MB/s, with higher SCSI
@@ -443,6 +864,8 @@ static int _scsi_read(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	bool first_read = true;
 	u8 *sdmmc_buf = (u8 *)SDXC_BUF_ALIGNED;
 
+	ums->ra.pending = false;
+
 	// Get the starting LBA and check that it's not too big.
 	if (ums->cmnd[0] == SC_READ_6)
 		lba_offset = get_array_be_to_le24(&ums->cmnd[1]);
@@ -453,14 +876,14 @@ static int _scsi_read(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 		// We allow DPO and FUA bypass cache bits, but we don't use them.
 		if ((ums->cmnd[1] & ~0x18) != 0)
 		{
-			ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+			ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 			return UMS_RES_INVALID_ARG;
 		}
 	}
-	if (lba_offset >= ums->lun.num_sectors)
+	if (lba_offset >= ums->lun->num_sectors)
 	{
-		ums->lun.sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+		ums->lun->sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -470,30 +893,71 @@ static int _scsi_read(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	if (!amount_left)
 		return UMS_RES_IO_ERROR; // No default reply.
 
+	// Write back cached data in range first.
+	if (_ums_cache_overlaps(&ums->lun->cache, lba_offset, amount_left) && !_ums_cache_flush(ums))
+	{
+		ums->lun->sense_data = SS_UNRECOVERED_READ_ERROR;
+		ums->lun->sense_data_info = lba_offset;
+		ums->lun->info_valid = 1;
+
+		return UMS_RES_INVALID_ARG;
+	}
+
 	// Limit IO transfers based on request for faster concurrent reads.
 	u32 max_io_transfer = (amount_left >= UMS_SCSI_TRANSFER_512K) ?
 		UMS_DISK_MAX_IO_TRANSFER_64K : UMS_DISK_MAX_IO_TRANSFER_32K;
 
+	u32 lba_start = lba_offset;
+	u32 amount_total = amount_left;
+
 	while (true)
 	{
 		// Max io size and end sector limits.
 		u32 amount = MIN(amount_left, max_io_transfer);
-		amount = MIN(amount, ums->lun.num_sectors - lba_offset);
+		amount = MIN(amount, ums->lun->num_sectors - lba_offset);
 
 		// Check if it is a read past the end sector.
 		if (!amount)
 		{
-			ums->lun.sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
-			ums->lun.sense_data_info = lba_offset;
-			ums->lun.info_valid = 1;
+			ums->lun->sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+			ums->lun->sense_data_info = lba_offset;
+			ums->lun->info_valid = 1;
 			bulk_ctxt->bulk_in_length = 0;
 			bulk_ctxt->bulk_in_buf_state = BUF_STATE_FULL;
 			break;
 		}
 
-		// Do the SDMMC read.
-		if (!sdmmc_storage_read(ums->lun.storage, ums->lun.offset + lba_offset, amount, sdmmc_buf))
-			amount = 0;
+		u8 *ra_buf = NULL;
+		u32 vec_cnt = 0;
+		u32 sdmmc_amount = amount;
+
+		/*
+		 * Serve from read-ahead if prefetched. If chained transfers are supported,
+		 * the read-ahead parts are sent straight from their buffers together with
+		 * the SDMMC read of the rest, in one transfer.
+		 * The vector is free, since the one in flight was consumed when queued.
+		 */
+		if (usb_ops.usb_device_ep1_in_writev)
+			sdmmc_amount = _ums_ra_gather(&ums->ra, ums->lun, lba_offset, amount, bulk_ctxt->bulk_in_vec, &vec_cnt);
+		else
+		{
+			ra_buf = _ums_ra_lookup(&ums->ra, ums->lun, lba_offset, &amount);
+			if (ra_buf)
+				sdmmc_amount = 0;
+		}
+
+		if (sdmmc_amount)
+		{
+			u32 sdmmc_lba = lba_offset + amount - sdmmc_amount;
+			if (!sdmmc_storage_read(ums->lun->storage, ums->lun->offset + sdmmc_lba, sdmmc_amount, sdmmc_buf))
+				amount = 0;
+			else if (vec_cnt)
+			{
+				bulk_ctxt->bulk_in_vec[vec_cnt].buf = sdmmc_buf;
+				bulk_ctxt->bulk_in_vec[vec_cnt].len = sdmmc_amount << UMS_DISK_LBA_SHIFT;
+				vec_cnt++;
+			}
+		}
 
 		// Wait for the async USB transfer to finish.
 		if (!first_read)
@@ -505,28 +969,36 @@ static int _scsi_read(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 
 		bulk_ctxt->bulk_in_length    = amount << UMS_DISK_LBA_SHIFT;
 		bulk_ctxt->bulk_in_buf_state = BUF_STATE_FULL;
-		bulk_ctxt->bulk_in_buf       = sdmmc_buf;
+		bulk_ctxt->bulk_in_buf       = ra_buf ? ra_buf : sdmmc_buf;
+		bulk_ctxt->bulk_in_vec_cnt   = amount ? vec_cnt : 0;
 
 		// If an error occurred, report it and its position.
 		if (!amount)
 		{
 			ums->set_text(ums->label, "#FFDD00 Error:# SDMMC Read!");
-			ums->lun.sense_data = SS_UNRECOVERED_READ_ERROR;
-			ums->lun.sense_data_info = lba_offset;
-			ums->lun.info_valid = 1;
+			ums->lun->sense_data = SS_UNRECOVERED_READ_ERROR;
+			ums->lun->sense_data_info = lba_offset;
+			ums->lun->info_valid = 1;
 			break;
 		}
 
 		// Last SDMMC read. Last part will be sent by the finish reply function.
 		if (!amount_left)
+		{
+			// Update read-ahead stream after the last part is sent.
+			ums->ra.pending = true;
+			ums->ra.pending_lba = lba_start;
+			ums->ra.pending_num = amount_total;
 			break;
+		}
 
 		// Start the USB transfer.
 		_ums_transfer_start(ums, bulk_ctxt, bulk_ctxt->bulk_in, USB_XFER_START);
 		first_read = false;
 
 		// Increment our buffer to read new data.
-		sdmmc_buf += amount << UMS_DISK_LBA_SHIFT;
+		if (sdmmc_amount)
+			sdmmc_buf += amount << UMS_DISK_LBA_SHIFT;
 	}
 
 	return UMS_RES_IO_ERROR; // No default reply.
@@ -535,8 +1007,11 @@ static int _scsi_read(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 /*
  * Writes are another story.
  * Tests showed that big writes are faster than concurrent 32K usb reads + writes.
- * The only thing that can help here is caching the writes. But for the simplicity
- * of this implementation it will not be implemented yet.
+ * So writes are cached in RAM, split in two halves. Contiguous writes are received
+ * straight into the active half and when it can't take more, it's written to SDMMC
+ * asynchronously while the other half gets filled.
+ * The cache is flushed on Synchronize Cache, Stop Unit, Allow Medium Removal,
+ * EP timeout, FUA writes, overlapping reads and on exit.
  */
 
 static int _scsi_write(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
@@ -545,10 +1020,12 @@ static int _scsi_write(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	u32 amount_left_to_req, amount_left_to_write;
 	u32 usb_lba_offset, lba_offset;
 	u32 amount;
+	ums_cache_t *cache = &ums->lun->cache;
+	bool cached = cache->buf != NULL;
 
-	if (ums->lun.ro)
+	if (ums->lun->ro)
 	{
-		ums->lun.sense_data = SS_WRITE_PROTECTED;
+		ums->lun->sense_data = SS_WRITE_PROTECTED;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -562,20 +1039,36 @@ static int _scsi_write(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 		// We allow DPO and FUA bypass cache bits. We only implement FUA by performing synchronous output.
 		if (ums->cmnd[1] & ~0x18)
 		{
-			ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+			ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 			return UMS_RES_INVALID_ARG;
 		}
+
+		if (ums->cmnd[1] & 0x08)
+			cached = false;
+	}
+
+	// Synchronous output must not be overwritten later by older cached data.
+	if (!cached && !_ums_cache_flush(ums))
+	{
+		ums->lun->sense_data = SS_WRITE_ERROR;
+		ums->lun->sense_data_info = lba_offset;
+		ums->lun->info_valid = 1;
+
+		return UMS_RES_INVALID_ARG;
 	}
 
 	// Check that starting LBA is not past the end sector offset.
-	if (lba_offset >= ums->lun.num_sectors)
+	if (lba_offset >= ums->lun->num_sectors)
 	{
-		ums->lun.sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+		ums->lun->sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
 
 		return UMS_RES_INVALID_ARG;
 	}
 
+	// Drop prefetched data that gets overwritten.
+	_ums_ra_invalidate_range(&ums->ra, ums->lun, lba_offset, ums->data_size_from_cmnd >> UMS_DISK_LBA_SHIFT);
+
 	/* Carry out the file writes */
 	usb_lba_offset = lba_offset;
 	amount_left_to_req = ums->data_size_from_cmnd;
@@ -591,16 +1084,34 @@ static int _scsi_write(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 			// Limit write to max supported read from EP OUT.
 			amount = MIN(amount_left_to_req, UMS_EP_OUT_MAX_XFER);
 
-			if (usb_lba_offset >= ums->lun.num_sectors) //////////Check if it works with concurrency
+			if (usb_lba_offset >= ums->lun->num_sectors) //////////Check if it works with concurrency
 			{
 				ums->set_text(ums->label, "#FFDD00 Error:# Write - Past last sector!");
 				amount_left_to_req = 0;
-				ums->lun.sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
-				ums->lun.sense_data_info = usb_lba_offset;
-				ums->lun.info_valid = 1;
+				ums->lun->sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+				ums->lun->sense_data_info = usb_lba_offset;
+				ums->lun->info_valid = 1;
 				continue;
 			}
 
+			if (cached)
+			{
+				amount = MIN(amount, cache->half_sz << UMS_DISK_LBA_SHIFT);
+
+				// Append to active extent if contiguous, EP aligned and fits. Otherwise start a new one.
+				if (cache->cnt && (cache->lba + cache->cnt != usb_lba_offset ||
+					((cache->cnt << UMS_DISK_LBA_SHIFT) % USB_EP_BUFFER_ALIGN) ||
+					(cache->cnt + (amount >> UMS_DISK_LBA_SHIFT)) > cache->half_sz))
+				{
+					_ums_cache_submit(cache);
+				}
+
+				if (!cache->cnt)
+					cache->lba = usb_lba_offset;
+
+				bulk_ctxt->bulk_out_buf = _ums_cache_half_buf(cache, cache->half) + (cache->cnt << UMS_DISK_LBA_SHIFT);
+			}
+
 			// Get the next buffer.
 			usb_lba_offset += amount >> UMS_DISK_LBA_SHIFT;
 			ums->usb_amount_left -= amount;
@@ -608,7 +1119,10 @@ static int _scsi_write(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 
 			bulk_ctxt->bulk_out_length = amount;
 
-			_ums_transfer_out_big_read(ums, bulk_ctxt);
+			if (cached)
+				_ums_transfer_out_cached_read(ums, bulk_ctxt);
+			else
+				_ums_transfer_out_big_read(ums, bulk_ctxt);
 		}
 
 		if (bulk_ctxt->bulk_out_buf_state == BUF_STATE_FULL)
@@ -618,9 +1132,9 @@ static int _scsi_write(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 			// Did something go wrong with the transfer?.
 			if (bulk_ctxt->bulk_out_status != 0)
 			{
-				ums->lun.sense_data = SS_COMMUNICATION_FAILURE;
-				ums->lun.sense_data_info = lba_offset;
-				ums->lun.info_valid = 1;
+				ums->lun->sense_data = SS_COMMUNICATION_FAILURE;
+				ums->lun->sense_data_info = lba_offset;
+				ums->lun->info_valid = 1;
 				s_printf(txt_buf, "#FFDD00 Error:# Write - Comm failure %d!", bulk_ctxt->bulk_out_status);
 				ums->set_text(ums->label, txt_buf);
 				break;
@@ -628,10 +1142,10 @@ static int _scsi_write(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 
 			amount = bulk_ctxt->bulk_out_length_actual;
 
-			if ((ums->lun.num_sectors - lba_offset) < (amount >> UMS_DISK_LBA_SHIFT))
+			if ((ums->lun->num_sectors - lba_offset) < (amount >> UMS_DISK_LBA_SHIFT))
 			{
-				DPRINTF("write %X @ %X beyond end %X\n", amount, lba_offset, ums->lun.num_sectors);
-				amount = (ums->lun.num_sectors - lba_offset) << UMS_DISK_LBA_SHIFT;
+				DPRINTF("write %X @ %X beyond end %X\n", amount, lba_offset, ums->lun->num_sectors);
+				amount = (ums->lun->num_sectors - lba_offset) << UMS_DISK_LBA_SHIFT;
 			}
 
 			/*
@@ -646,7 +1160,18 @@ static int _scsi_write(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 				goto empty_write;
 
 			/* Perform the write */
-			if (!sdmmc_storage_write(ums->lun.storage, ums->lun.offset + lba_offset,
+			if (cached)
+			{
+				cache->cnt += amount >> UMS_DISK_LBA_SHIFT;
+
+				// Report a deferred error from a previous extent.
+				if (cache->error)
+				{
+					cache->error = false;
+					amount = 0;
+				}
+			}
+			else if (!sdmmc_storage_write(ums->lun->storage, ums->lun->offset + lba_offset,
 				amount >> UMS_DISK_LBA_SHIFT, (u8 *)bulk_ctxt->bulk_out_buf))
 				amount = 0;
 
@@ -660,9 +1185,9 @@ DPRINTF("file write %X @ %X\n", amount, lba_offset);
 			if (!amount)
 			{
 				ums->set_text(ums->label, "#FFDD00 Error:# SDMMC Write!");
-				ums->lun.sense_data = SS_WRITE_ERROR;
-				ums->lun.sense_data_info = lba_offset;
-				ums->lun.info_valid = 1;
+				ums->lun->sense_data = SS_WRITE_ERROR;
+				ums->lun->sense_data_info = lba_offset;
+				ums->lun->info_valid = 1;
 				break;
 			}
 
@@ -677,6 +1202,9 @@ DPRINTF("file write %X @ %X\n", amount, lba_offset);
 		}
 	}
 
+	// In case we used the cache, reset the buffer address.
+	_ums_reset_buffer(bulk_ctxt, bulk_ctxt->bulk_out);
+
 	return UMS_RES_IO_ERROR; // No default reply.
 }
 
@@ -684,9 +1212,9 @@ static int _scsi_verify(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 {
 	// Check that start LBA is past the end sector offset.
 	u32 lba_offset = get_array_be_to_le32(&ums->cmnd[2]);
-	if (lba_offset >= ums->lun.num_sectors)
+	if (lba_offset >= ums->lun->num_sectors)
 	{
-		ums->lun.sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+		ums->lun->sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -694,7 +1222,7 @@ static int _scsi_verify(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	// We allow DPO but we don't implement it. Check that nothing else is enabled.
 	if (ums->cmnd[1] & ~0x10)
 	{
-		ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+		ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -703,21 +1231,31 @@ static int _scsi_verify(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	if (verification_length == 0)
 		return UMS_RES_IO_ERROR; // No default reply.
 
+	// Write back cached data in range first.
+	if (_ums_cache_overlaps(&ums->lun->cache, lba_offset, verification_length) && !_ums_cache_flush(ums))
+	{
+		ums->lun->sense_data = SS_WRITE_ERROR;
+		ums->lun->sense_data_info = lba_offset;
+		ums->lun->info_valid = 1;
+
+		return UMS_RES_INVALID_ARG;
+	}
+
 	u32 amount;
 	while (verification_length > 0)
 	{
 
 		// Limit to EP buffer size and end sector offset.
 		amount = MIN(verification_length, USB_EP_BUFFER_MAX_SIZE >> UMS_DISK_LBA_SHIFT);
-		amount = MIN(amount, ums->lun.num_sectors - lba_offset);
+		amount = MIN(amount, ums->lun->num_sectors - lba_offset);
 		if (amount == 0) {
-			ums->lun.sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
-			ums->lun.sense_data_info = lba_offset;
-			ums->lun.info_valid = 1;
+			ums->lun->sense_data = SS_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE;
+			ums->lun->sense_data_info = lba_offset;
+			ums->lun->info_valid = 1;
 			break;
 		}
 
-		if (!sdmmc_storage_read(ums->lun.storage, ums->lun.offset + lba_offset, amount, bulk_ctxt->bulk_in_buf))
+		if (!sdmmc_storage_read(ums->lun->storage, ums->lun->offset + lba_offset, amount, bulk_ctxt->bulk_in_buf))
 			amount = 0;
 
 DPRINTF("File read %X @ %X\n", amount, lba_offset);
@@ -725,9 +1263,9 @@ DPRINTF("File read %X @ %X\n", amount, lba_offset);
 		if (!amount)
 		{
 			ums->set_text(ums->label, "#FFDD00 Error:# File verify!");
-			ums->lun.sense_data = SS_UNRECOVERED_READ_ERROR;
-			ums->lun.sense_data_info = lba_offset;
-			ums->lun.info_valid = 1;
+			ums->lun->sense_data = SS_UNRECOVERED_READ_ERROR;
+			ums->lun->sense_data_info = lba_offset;
+			ums->lun->info_valid = 1;
 			break;
 		}
 		lba_offset += amount;
@@ -752,9 +1290,9 @@ static int _scsi_inquiry(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 
 		buf += 4;
 		s_printf((char *)buf, "%04X%s",
-			ums->lun.storage->cid.serial, ums->lun.type == MMC_SD ? " SD " : " eMMC ");
+			ums->lun->storage->cid.serial, ums->lun->type == MMC_SD ? " SD " : " eMMC ");
 
-		switch (ums->lun.partition)
+		switch (ums->lun->partition)
 		{
 		case 0:
 			strcpy((char *)buf + strlen((char *)buf), "RAW");
@@ -778,7 +1316,7 @@ static int _scsi_inquiry(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	else /* if (ums->cmnd[1] == 0 && ums->cmnd[2] == 0) */ // Standard inquiry.
 	{
 		buf[0] = SCSI_TYPE_DISK;
-		buf[1] = ums->lun.removable ? 0x80 : 0;
+		buf[1] = ums->lun->removable ? 0x80 : 0;
 		buf[2] = 6;  // ANSI INCITS 351-2001 (SPC-2).////////SPC2: 4, SPC4: 6
 		buf[3] = 2;  // SCSI-2 INQUIRY data format.
 		buf[4] = 31; // Additional length.
@@ -790,22 +1328,22 @@ static int _scsi_inquiry(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 
 		// Product ID. Max 16 chars.
 		buf += 8;
-		switch (ums->lun.partition)
+		switch (ums->lun->partition)
 		{
 		case 0:
 			s_printf((char *)buf, "%s", "SD RAW");
 			break;
 		case EMMC_GPP + 1:
 			s_printf((char *)buf, "%s%s",
-				ums->lun.type == MMC_SD ? "SD " : "eMMC ", "GPP");
+				ums->lun->type == MMC_SD ? "SD " : "eMMC ", "GPP");
 			break;
 		case EMMC_BOOT0 + 1:
 			s_printf((char *)buf, "%s%s",
-				ums->lun.type == MMC_SD ? "SD " : "eMMC ", "BOOT0");
+				ums->lun->type == MMC_SD ? "SD " : "eMMC ", "BOOT0");
 			break;
 		case EMMC_BOOT1 + 1:
 			s_printf((char *)buf, "%s%s",
-				ums->lun.type == MMC_SD ? "SD " : "eMMC ", "BOOT1");
+				ums->lun->type == MMC_SD ? "SD " : "eMMC ", "BOOT1");
 			break;
 		}
 
@@ -823,12 +1361,12 @@ static int _scsi_request_sense(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	u32 sd, sdinfo;
 	int valid;
 
-	sd = ums->lun.sense_data;
-	sdinfo = ums->lun.sense_data_info;
-	valid = ums->lun.info_valid << 7;
-	ums->lun.sense_data = SS_NO_SENSE;
-	ums->lun.sense_data_info = 0;
-	ums->lun.info_valid = 0;
+	sd = ums->lun->sense_data;
+	sdinfo = ums->lun->sense_data_info;
+	valid = ums->lun->info_valid << 7;
+	ums->lun->sense_data = SS_NO_SENSE;
+	ums->lun->sense_data_info = 0;
+	ums->lun->info_valid = 0;
 
 	memset(buf, 0, 18);
 	buf[0]  = valid | 0x70; // Valid, current error.
@@ -850,12 +1388,12 @@ static int _scsi_read_capacity(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	// Check the PMI and LBA fields.
 	if (pmi > 1 || (pmi == 0 && lba != 0))
 	{
-		ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+		ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 		return UMS_RES_INVALID_ARG;
 	}
 
-	put_array_le_to_be32(ums->lun.num_sectors - 1, &buf[0]); // Max logical block.
+	put_array_le_to_be32(ums->lun->num_sectors - 1, &buf[0]); // Max logical block.
 	put_array_le_to_be32(UMS_DISK_LBA_SIZE, &buf[4]);        // Block length.
 
 	return 8;
@@ -873,14 +1411,14 @@ static int _scsi_log_sense(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 
 	if (ums->cmnd[1] & 1)
 	{
-		ums->lun.sense_data = SS_SAVING_PARAMETERS_NOT_SUPPORTED;
+		ums->lun->sense_data = SS_SAVING_PARAMETERS_NOT_SUPPORTED;
 
 		return UMS_RES_INVALID_ARG;
 	}
 
 	if (pc != 1) // Current cumulative values.
 	{
-		ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+		ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -922,7 +1460,7 @@ static int _scsi_log_sense(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	u32 len = buf - buf0;
 	if (!valid_page)
 	{
-		ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+		ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -945,14 +1483,14 @@ static int _scsi_mode_sense(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 
 	if ((ums->cmnd[1] & ~0x08) != 0) // Mask away DBD.
 	{
-		ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+		ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 		return UMS_RES_INVALID_ARG;
 	}
 
 	if (pc == 3)
 	{
-		ums->lun.sense_data = SS_SAVING_PARAMETERS_NOT_SUPPORTED;
+		ums->lun->sense_data = SS_SAVING_PARAMETERS_NOT_SUPPORTED;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -964,12 +1502,12 @@ static int _scsi_mode_sense(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	memset(buf, 0, 8);
 	if (ums->cmnd[0] == SC_MODE_SENSE_6)
 	{
-		buf[2] = (ums->lun.ro ? 0x80 : 0x00); // WP, DPOFUA.
+		buf[2] = (ums->lun->ro ? 0x80 : 0x00); // WP, DPOFUA.
 		buf += 4;
 	}
 	else // SC_MODE_SENSE_10.
 	{
-		buf[3] = (ums->lun.ro ? 0x80 : 0x00); // WP, DPOFUA.
+		buf[3] = (ums->lun->ro ? 0x80 : 0x00); // WP, DPOFUA.
 		buf += 8;
 	}
 
@@ -1002,7 +1540,7 @@ static int _scsi_mode_sense(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	u32 len = buf - buf0;
 	if (!valid_page)
 	{
-		ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+		ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -1020,16 +1558,16 @@ static int _scsi_start_stop(usbd_gadget_ums_t *ums)
 {
 	int loej, start;
 
-	if (!ums->lun.removable)
+	if (!ums->lun->removable)
 	{
-		ums->lun.sense_data = SS_INVALID_COMMAND;
+		ums->lun->sense_data = SS_INVALID_COMMAND;
 
 		return UMS_RES_INVALID_ARG;
 	}
 	else if ((ums->cmnd[1] & ~0x01) != 0 || // Mask away Immed.
 		(ums->cmnd[4] & ~0x03) != 0)        // Mask LoEj, Start.
 	{
-		ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+		ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -1040,9 +1578,9 @@ static int _scsi_start_stop(usbd_gadget_ums_t *ums)
 	// We do not support re-mounting.
 	if (start)
 	{
-		if (ums->lun.unmounted)
+		if (ums->lun->unmounted)
 		{
-			ums->lun.sense_data = SS_MEDIUM_NOT_PRESENT;
+			ums->lun->sense_data = SS_MEDIUM_NOT_PRESENT;
 
 			return UMS_RES_INVALID_ARG;
 		}
@@ -1050,11 +1588,19 @@ static int _scsi_start_stop(usbd_gadget_ums_t *ums)
 		return UMS_RES_OK;
 	}
 
+	// Stopping. Write back cached data.
+	if (!_ums_cache_flush(ums))
+	{
+		ums->lun->sense_data = SS_WRITE_ERROR;
+
+		return UMS_RES_INVALID_ARG;
+	}
+
 	// Check if we are allowed to unload the media.
-	if (ums->lun.prevent_medium_removal)
+	if (ums->lun->prevent_medium_removal)
 	{
 		ums->set_text(ums->label, "#C7EA46 Status:# Unload attempt prevented");
-		ums->lun.sense_data = SS_MEDIUM_REMOVAL_PREVENTED;
+		ums->lun->sense_data = SS_MEDIUM_REMOVAL_PREVENTED;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -1063,7 +1609,7 @@ static int _scsi_start_stop(usbd_gadget_ums_t *ums)
 		return UMS_RES_OK;
 
 	// Unmount means we exit UMS because of ejection.
-	ums->lun.unmounted = 1;
+	ums->lun->unmounted = 1;
 
 	return UMS_RES_OK;
 }
@@ -1072,9 +1618,9 @@ static int _scsi_prevent_allow_removal(usbd_gadget_ums_t *ums)
 {
 	int prevent;
 
-	if (!ums->lun.removable)
+	if (!ums->lun->removable)
 	{
-		ums->lun.sense_data = SS_INVALID_COMMAND;
+		ums->lun->sense_data = SS_INVALID_COMMAND;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -1082,17 +1628,20 @@ static int _scsi_prevent_allow_removal(usbd_gadget_ums_t *ums)
 	prevent = ums->cmnd[4] & 0x01;
 	if ((ums->cmnd[4] & ~0x01) != 0) // Mask away Prevent.
 	{
-		ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+		ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 		return UMS_RES_INVALID_ARG;
 	}
 
-	// Notify for possible unmounting?
-	// Normally we sync here but we do synced writes to SDMMC.
-	if (ums->lun.prevent_medium_removal && !prevent)
-		;
+	// Possible unmounting. Write back cached data.
+	if (ums->lun->prevent_medium_removal && !prevent && !_ums_cache_flush(ums))
+	{
+		ums->lun->sense_data = SS_WRITE_ERROR;
+
+		return UMS_RES_INVALID_ARG;
+	}
 
-	ums->lun.prevent_medium_removal = prevent;
+	ums->lun->prevent_medium_removal = prevent;
 
 	return UMS_RES_OK;
 }
@@ -1105,7 +1654,7 @@ static int _scsi_read_format_capacities(usbd_gadget_ums_t *ums, bulk_ctxt_t *bul
 	buf[3] = 8; // Only the Current/Maximum Capacity Descriptor.
 	buf += 4;
 
-	put_array_le_to_be32(ums->lun.num_sectors, &buf[0]); // Number of blocks.
+	put_array_le_to_be32(ums->lun->num_sectors, &buf[0]); // Number of blocks.
 	put_array_le_to_be32(UMS_DISK_LBA_SIZE, &buf[4]);    // Block length.
 	buf[4] = 0x02; // Current capacity.
 
@@ -1163,18 +1712,18 @@ DPRINTF("SCSI command: %X;  Dc=%d, D%c=%X;  Hc=%d, H%c=%X\n",
 
 	if (ums->cmnd[0] != SC_REQUEST_SENSE)
 	{
-		ums->lun.sense_data = SS_NO_SENSE;
-		ums->lun.sense_data_info = 0;
-		ums->lun.info_valid = 0;
+		ums->lun->sense_data = SS_NO_SENSE;
+		ums->lun->sense_data_info = 0;
+		ums->lun->info_valid = 0;
 	}
 
 	// If a unit attention condition exists, only INQUIRY and REQUEST SENSE
 	// commands are allowed.
-	if (ums->lun.unit_attention_data != SS_NO_SENSE && ums->cmnd[0] != SC_INQUIRY &&
+	if (ums->lun->unit_attention_data != SS_NO_SENSE && ums->cmnd[0] != SC_INQUIRY &&
 		ums->cmnd[0] != SC_REQUEST_SENSE)
 	{
-		ums->lun.sense_data = ums->lun.unit_attention_data;
-		ums->lun.unit_attention_data = SS_NO_SENSE;
+		ums->lun->sense_data = ums->lun->unit_attention_data;
+		ums->lun->unit_attention_data = SS_NO_SENSE;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -1185,16 +1734,24 @@ DPRINTF("SCSI command: %X;  Dc=%d, D%c=%X;  Hc=%d, H%c=%X\n",
 	{
 		if (ums->cmnd[i] && !(mask & BIT(i)))
 		{
-			ums->lun.sense_data = SS_INVALID_FIELD_IN_CDB;
+			ums->lun->sense_data = SS_INVALID_FIELD_IN_CDB;
 
 			return UMS_RES_INVALID_ARG;
 		}
 	}
 
 	// If the medium isn't mounted and the command needs to access it, return an error.
-	if (ums->lun.unmounted && needs_medium)
+	if (ums->lun->unmounted && needs_medium)
+	{
+		ums->lun->sense_data = SS_MEDIUM_NOT_PRESENT;
+
+		return UMS_RES_INVALID_ARG;
+	}
+
+	// LUNs can share a storage. Switch to the partition of the LUN.
+	if (needs_medium && !_ums_lun_set_partition(ums))
 	{
-		ums->lun.sense_data = SS_MEDIUM_NOT_PRESENT;
+		ums->lun->sense_data = SS_MEDIUM_NOT_PRESENT;
 
 		return UMS_RES_INVALID_ARG;
 	}
@@ -1235,7 +1792,7 @@ static int _ums_parse_scsi_cmd(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 		if (reply == 0)
 		{
 			// We don't support MODE SELECT.
-			ums->lun.sense_data = SS_INVALID_COMMAND;
+			ums->lun->sense_data = SS_INVALID_COMMAND;
 			reply = UMS_RES_INVALID_ARG;
 		}
 		break;
@@ -1246,7 +1803,7 @@ static int _ums_parse_scsi_cmd(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 		if (reply == 0)
 		{
 			// We don't support MODE SELECT.
-			ums->lun.sense_data = SS_INVALID_COMMAND;
+			ums->lun->sense_data = SS_INVALID_COMMAND;
 			reply = UMS_RES_INVALID_ARG;
 		}
 		break;
@@ -1324,8 +1881,11 @@ static int _ums_parse_scsi_cmd(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	case SC_SYNCHRONIZE_CACHE:
 		ums->data_size_from_cmnd = 0;
 		reply = _ums_check_scsi_cmd(ums, 10, DATA_DIR_NONE, (0xf<<2) | (3<<7), 1);
-		if (reply == 0)
-			reply = 0; // Don't bother
+		if (reply == 0 && !_ums_cache_flush(ums))
+		{
+			ums->lun->sense_data = SS_WRITE_ERROR;
+			reply = UMS_RES_INVALID_ARG;
+		}
 		break;
 
 	case SC_TEST_UNIT_READY:
@@ -1375,7 +1935,7 @@ static int _ums_parse_scsi_cmd(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 		reply = _ums_check_scsi_cmd(ums, ums->cmnd_size, DATA_DIR_UNKNOWN, 0xFF, 0);
 		if (reply == 0)
 		{
-			ums->lun.sense_data = SS_INVALID_COMMAND;
+			ums->lun->sense_data = SS_INVALID_COMMAND;
 			reply = UMS_RES_INVALID_ARG;
 		}
 		break;
@@ -1399,6 +1959,15 @@ static int _ums_parse_scsi_cmd(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 static int pad_with_zeros(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 {
 	bulk_ctxt->bulk_in_buf_state = BUF_STATE_EMPTY; // For the first iteration.
+
+	// Send chained parts first. They can't be padded in place.
+	if (bulk_ctxt->bulk_in_vec_cnt)
+	{
+		_ums_transfer_start(ums, bulk_ctxt, bulk_ctxt->bulk_in, USB_XFER_SYNCED_DATA);
+		_ums_reset_buffer(bulk_ctxt, bulk_ctxt->bulk_in);
+		bulk_ctxt->bulk_in_length = 0;
+	}
+
 	u32 current_len_to_keep = bulk_ctxt->bulk_in_length;
 	ums->usb_amount_left = current_len_to_keep + ums->residue;
 
@@ -1490,6 +2059,9 @@ static int finish_reply(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 
 		// In case we used SDMMC transfer, reset the buffer address.
 		_ums_reset_buffer(bulk_ctxt, bulk_ctxt->bulk_in);
+
+		// Buffers are free. Prefetch next data.
+		_ums_ra_update(ums);
 		break;
 
 	// We have processed all we want from the data the host has sent.
@@ -1541,15 +2113,19 @@ static int finish_reply(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 static int received_cbw(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 {
 	/* Was this a real packet?  Should it be ignored? */
-	if (bulk_ctxt->bulk_out_status || bulk_ctxt->bulk_out_ignore || ums->lun.unmounted)
+	bool unmounted = _ums_luns_unmounted(ums);
+	if (bulk_ctxt->bulk_out_status || bulk_ctxt->bulk_out_ignore || unmounted)
 	{
-		if (bulk_ctxt->bulk_out_status || ums->lun.unmounted)
+		if (bulk_ctxt->bulk_out_status || unmounted)
 		{
 			DPRINTF("USB: EP timeout\n");
+			// Idle or disconnected. Write back cached data. Errors are reported on next sync.
+			_ums_cache_writeback_all(ums);
+
 			// In case we disconnected, exit UMS.
 			// Raise timeout if removable and didn't got a unit ready command inside 4s.
 			if (bulk_ctxt->bulk_out_status == USB2_ERROR_XFER_EP_DISABLED ||
-				(bulk_ctxt->bulk_out_status == USB_ERROR_TIMEOUT && ums->lun.removable && !ums->lun.prevent_medium_removal))
+				(bulk_ctxt->bulk_out_status == USB_ERROR_TIMEOUT && !_ums_luns_prevent_removal(ums)))
 			{
 				if (bulk_ctxt->bulk_out_status == USB_ERROR_TIMEOUT)
 				{
@@ -1572,7 +2148,7 @@ static int received_cbw(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 				}
 			}
 
-			if (ums->lun.unmounted)
+			if (unmounted)
 			{
 				ums->set_text(ums->label, "#C7EA46 Status:# Medium unmounted");
 				ums->timeouts++;
@@ -1607,7 +2183,7 @@ static int received_cbw(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	}
 
 	/* Is the CBW meaningful? */
-	if (cbw->Lun >= UMS_MAX_LUN || cbw->Flags & ~USB_BULK_IN_FLAG ||
+	if (cbw->Lun >= ums->lun_cnt || cbw->Flags & ~USB_BULK_IN_FLAG ||
 			cbw->Length <= 0 || cbw->Length > SCSI_MAX_CMD_SZ)
 	{
 		gfx_printf("USB: non-meaningful CBW: lun = %X, flags = 0x%X, cmdlen %X\n",
@@ -1640,9 +2216,10 @@ static int received_cbw(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 		ums->data_dir = DATA_DIR_NONE;
 
 	ums->lun_idx = cbw->Lun;
+	ums->lun = &ums->luns[cbw->Lun];
 	ums->tag = cbw->Tag;
 
-	if (!ums->lun.unmounted)
+	if (!unmounted)
 		ums->timeouts = 0;
 
 	return UMS_RES_OK;
@@ -1682,7 +2259,7 @@ static int get_next_command(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 static void send_status(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 {
 	u8  status = USB_STATUS_PASS;
-	u32 sd = ums->lun.sense_data;
+	u32 sd = ums->lun->sense_data;
 
 	if (ums->phase_error)
 	{
@@ -1695,7 +2272,7 @@ static void send_status(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 		DPRINTF("USB: CMD fail\n");
 		status = USB_STATUS_FAIL;
 		DPRINTF("USB:   Sense: SK x%02X, ASC x%02X, ASCQ x%02X; info x%X\n",
-			SK(sd), ASC(sd), ASCQ(sd), ums->lun.sense_data_info);
+			SK(sd), ASC(sd), ASCQ(sd), ums->lun->sense_data_info);
 	}
 
 	/* Store and send the Bulk-only CSW */
@@ -1722,17 +2299,21 @@ static void handle_exception(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 	 * state, and the exception.  Then invoke the handler. */
 
 	bulk_ctxt->bulk_in_buf_state = BUF_STATE_EMPTY;
+	bulk_ctxt->bulk_in_vec_cnt = 0;
 	bulk_ctxt->bulk_out_buf_state = BUF_STATE_EMPTY;
 
 	old_state = ums->state;
 
 	if (old_state != UMS_STATE_ABORT_BULK_OUT)
 	{
-		ums->lun.prevent_medium_removal = 0;
-		ums->lun.sense_data = SS_NO_SENSE;
-		ums->lun.unit_attention_data = SS_NO_SENSE;
-		ums->lun.sense_data_info = 0;
-		ums->lun.info_valid = 0;
+		for (u32 i = 0; i < ums->lun_cnt; i++)
+		{
+			ums->luns[i].prevent_medium_removal = 0;
+			ums->luns[i].sense_data = SS_NO_SENSE;
+			ums->luns[i].unit_attention_data = SS_NO_SENSE;
+			ums->luns[i].sense_data_info = 0;
+			ums->luns[i].info_valid = 0;
+		}
 	}
 
 	ums->state = UMS_STATE_NORMAL;
@@ -1755,7 +2336,8 @@ static void handle_exception(usbd_gadget_ums_t *ums, bulk_ctxt_t *bulk_ctxt)
 			bulk_ctxt->bulk_out_ignore = 0;
 			ums_clear_stall(bulk_ctxt->bulk_in);
 		}
-		ums->lun.unit_attention_data = SS_RESET_OCCURRED;
+		for (u32 i = 0; i < ums->lun_cnt; i++)
+			ums->luns[i].unit_attention_data = SS_RESET_OCCURRED;
 		break;
 
 	case UMS_STATE_EXIT:
@@ -1781,6 +2363,8 @@ static inline void _system_maintainance(usbd_gadget_ums_t *ums)
 	}
 	else if (timer_dram < time)
 	{
+		// Do not retrain while SDMMC DMA is active.
+		_ums_cache_wait_all(ums);
 		minerva_periodic_training();
 		timer_dram = get_tmr_ms() + EMC_PERIODIC_TRAIN_MS;
 	}
@@ -1790,7 +2374,7 @@ int usb_device_gadget_ums(usb_ctxt_t *usbs)
 {
 	int res = 0;
 	sdmmc_t sdmmc;
-	sdmmc_storage_t storage;
+	sdmmc_storage_t storage = {0};
 	usbd_gadget_ums_t ums = {0};
 
 	// Get USB Controller ops.
@@ -1819,13 +2403,22 @@ int usb_device_gadget_ums(usb_ctxt_t *usbs)
 	ums.bulk_ctxt.bulk_out = USB_EP_BULK_OUT;
 	ums.bulk_ctxt.bulk_out_buf = (u8 *)USB_EP_BULK_OUT_BUF_ADDR;
 
-	// Set LUN parameters.
-	ums.lun.ro = usbs->ro;
-	ums.lun.type = usbs->type;
-	ums.lun.partition = usbs->partition;
-	ums.lun.offset = usbs->offset;
-	ums.lun.removable = 1; // Always removable to force OSes to use prevent media removal.
-	ums.lun.unit_attention_data = SS_RESET_OCCURRED;
+	// Set LUN parameters. First LUN is the main one.
+	ums.lun_cnt = 1 + MIN(usbs->ext_luns, UMS_MAX_LUN - 1);
+	for (u32 i = 0; i < ums.lun_cnt; i++)
+	{
+		logical_unit_t *lun = &ums.luns[i];
+		usb_ums_lun_t *lun_cfg = i ? &usbs->ext_lun[i - 1] : NULL;
+
+		lun->ro        = lun_cfg ? lun_cfg->ro        : usbs->ro;
+		lun->type      = lun_cfg ? lun_cfg->type      : usbs->type;
+		lun->partition = lun_cfg ? lun_cfg->partition : usbs->partition;
+		lun->offset    = lun_cfg ? lun_cfg->offset    : usbs->offset;
+		lun->num_sectors = lun_cfg ? lun_cfg->sectors : usbs->sectors;
+		lun->removable = 1; // Always removable to force OSes to use prevent media removal.
+		lun->unit_attention_data = SS_RESET_OCCURRED;
+	}
+	ums.lun = &ums.luns[0];
 
 	// Set system functions
 	ums.label = usbs->label;
@@ -1834,20 +2427,42 @@ int usb_device_gadget_ums(usb_ctxt_t *usbs)
 
 	ums.set_text(ums.label, "#C7EA46 Status:# Mounting disk");
 
-	// Initialize sdmmc.
-	if (usbs->type == MMC_SD)
-	{
-		sd_mount();
-		sd_unmount();
-		ums.lun.sdmmc = &sd_sdmmc;
-		ums.lun.storage = &sd_storage;
-	}
-	else
+	// Initialize sdmmc. LUNs of the same type share the controller.
+	bool sd_init = false;
+	bool emmc_init = false;
+	u32 cached_luns = 0;
+	for (u32 i = 0; i < ums.lun_cnt; i++)
 	{
-		ums.lun.sdmmc = &sdmmc;
-		ums.lun.storage = &storage;
-		sdmmc_storage_init_mmc(ums.lun.storage, ums.lun.sdmmc, SDMMC_BUS_WIDTH_8, SDHCI_TIMING_MMC_HS400);
-		sdmmc_storage_set_mmc_partition(ums.lun.storage, ums.lun.partition - 1);
+		logical_unit_t *lun = &ums.luns[i];
+
+		if (lun->type == MMC_SD)
+		{
+			if (!sd_init)
+			{
+				sd_mount();
+				sd_unmount();
+				sd_init = true;
+			}
+			lun->sdmmc = &sd_sdmmc;
+			lun->storage = &sd_storage;
+		}
+		else
+		{
+			lun->sdmmc = &sdmmc;
+			lun->storage = &storage;
+			if (!emmc_init)
+			{
+				sdmmc_storage_init_mmc(lun->storage, lun->sdmmc, SDMMC_BUS_WIDTH_8, SDHCI_TIMING_MMC_HS400);
+				emmc_init = true;
+			}
+			sdmmc_storage_set_mmc_partition(lun->storage, lun->partition - 1);
+		}
+
+		if (!lun->num_sectors)
+			lun->num_sectors = lun->storage->sec_cnt;
+
+		if (!lun->ro)
+			cached_luns++;
 	}
 
 	ums.set_text(ums.label, "#C7EA46 Status:# Waiting for connection");
@@ -1858,15 +2473,31 @@ int usb_device_gadget_ums(usb_ctxt_t *usbs)
 
 	ums.set_text(ums.label, "#C7EA46 Status:# Waiting for LUN");
 
-	if (usb_ops.usb_device_class_send_max_lun(0)) // One device for now.
+	if (usb_ops.usb_device_class_send_max_lun(ums.lun_cnt - 1))
 		goto error;
 
 	ums.set_text(ums.label, "#C7EA46 Status:# Started UMS");
 
-	if (usbs->sectors)
-		ums.lun.num_sectors = usbs->sectors;
-	else
-		ums.lun.num_sectors = ums.lun.storage->sec_cnt;
+	// Set read-ahead buffers.
+	for (u32 i = 0; i < UMS_RA_ENTRIES; i++)
+		ums.ra.entry[i].buf = (u8 *)UMS_RA_ADDR + i * (UMS_RA_ENTRY_SZ << UMS_DISK_LBA_SHIFT);
+
+	// Set write-back caches. Split between writable LUNs.
+	u32 cache_size = MIN(usbs->cache_size, UMS_CACHE_SZ_MAX >> 20) << 20;
+	cache_size = cached_luns ? (cache_size / cached_luns) & ~(USB_EP_BUFFER_MAX_SIZE * 2 - 1) : 0;
+	u8 *cache_buf = (u8 *)UMS_CACHE_ADDR;
+	for (u32 i = 0; i < ums.lun_cnt && cache_size >= UMS_CACHE_MIN_SZ; i++)
+	{
+		logical_unit_t *lun = &ums.luns[i];
+		if (lun->ro)
+			continue;
+
+		lun->cache.buf = cache_buf;
+		lun->cache.storage = lun->storage;
+		lun->cache.offset = lun->offset;
+		lun->cache.half_sz = (cache_size / 2) >> UMS_DISK_LBA_SHIFT;
+		cache_buf += cache_size;
+	}
 
 	do
 	{
@@ -1877,7 +2508,7 @@ int usb_device_gadget_ums(usb_ctxt_t *usbs)
 		if (btn_read_vol() == (BTN_VOL_UP | BTN_VOL_DOWN))
 		{
 			// Check if we are allowed to unload the media.
-			if (ums.lun.prevent_medium_removal)
+			if (_ums_luns_prevent_removal(&ums))
 				ums.set_text(ums.label, "#C7EA46 Status:# Unload attempt prevented");
 			else
 				break;
@@ -1915,8 +2546,16 @@ error:
 	res = 1;
 
 exit:
-	if (ums.lun.type == MMC_EMMC)
-		sdmmc_storage_end(ums.lun.storage);
+	_ums_ra_invalidate(&ums.ra);
+
+	// Never lose dirty data.
+	_ums_cache_writeback_all(&ums);
+	for (u32 i = 0; i < ums.lun_cnt; i++)
+		if (ums.luns[i].cache.error)
+			ums.set_text(ums.label, "#FFDD00 Error:# SDMMC Write!");
+
+	if (emmc_init)
+		sdmmc_storage_end(&storage);
 
 	usb_ops.usbd_end(true, false);
 
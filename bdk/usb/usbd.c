@@ -1589,7 +1589,10 @@ void usb_device_get_ops(usb_ops_t *ops)
 	ops->usb_device_ep1_out_read           = usb_device_ep1_out_read;
 	ops->usb_device_ep1_out_read_big       = usb_device_ep1_out_read_big;
 	ops->usb_device_ep1_out_reading_finish = usb_device_ep1_out_reading_finish;
+	ops->usb_device_ep1_out_reading_wait   = NULL;
+	ops->usb_device_ep1_out_readv          = NULL;
 	ops->usb_device_ep1_in_write           = usb_device_ep1_in_write;
 	ops->usb_device_ep1_in_writing_finish  = usb_device_ep1_in_writing_finish;
+	ops->usb_device_ep1_in_writev          = NULL;
 }
 
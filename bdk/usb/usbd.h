@@ -29,6 +29,7 @@
 #define USB_EP_BUFFER_4_TD      (USB_TD_BUFFER_MAX_SIZE * 4)
 #define USB_EP_BUFFER_MAX_SIZE  (USB_EP_BUFFER_4_TD)
 #define USB_EP_BUFFER_ALIGN     (USB_TD_BUFFER_PAGE_SIZE)
+#define USB_EP_VEC_MAX_SIZE     (USB_EP_BUFFER_MAX_SIZE * 8) // If 64KB aligned.
 
 #define USB_XFER_START        0
 #define USB_XFER_SYNCED_ENUM  1000000
@@ -162,6 +163,12 @@ typedef struct _usb_ctrl_setup_t
 	u16 wLength;
 } usb_ctrl_setup_t;
 
+typedef struct _usb_xfer_vec_t
+{
+	u8 *buf;
+	u32 len;
+} usb_xfer_vec_t;
+
 typedef struct _usb_ops_t
 {
 	int  (*usbd_flush_endpoint)(u32);
@@ -176,12 +183,26 @@ typedef struct _usb_ops_t
 	int  (*usb_device_ep1_out_read)(u8 *, u32, u32 *, u32);
 	int  (*usb_device_ep1_out_read_big)(u8 *, u32, u32 *);
 	int  (*usb_device_ep1_out_reading_finish)(u32 *);
+	int  (*usb_device_ep1_out_reading_wait)(u32 *, u32); // Waits a queued OUT transfer. XUSB only.
+	int  (*usb_device_ep1_out_readv)(const usb_xfer_vec_t *, u32, u32 *, u32);
 	int  (*usb_device_ep1_in_write)(u8 *, u32, u32 *, u32);
 	int  (*usb_device_ep1_in_writing_finish)(u32 *);
+	int  (*usb_device_ep1_in_writev)(const usb_xfer_vec_t *, u32, u32 *, u32);
 	bool (*usb_device_get_suspended)();
 	bool (*usb_device_get_port_in_sleep)();
 } usb_ops_t;
 
+#define UMS_MAX_LUN 4
+
+typedef struct _usb_ums_lun_t
+{
+	u32 type;
+	u32 partition;
+	u32 offset;
+	u32 sectors;
+	u32 ro;
+} usb_ums_lun_t;
+
 typedef struct _usb_ctxt_t
 {
 	u32 type;
@@ -189,6 +210,9 @@ typedef struct _usb_ctxt_t
 	u32 offset;
 	u32 sectors;
 	u32 ro;
+	u32 cache_size; // Write-back cache size in MiB. 0: Disabled.
+	u32 ext_luns;   // Extra UMS LUNs after the main one.
+	usb_ums_lun_t ext_lun[UMS_MAX_LUN - 1];
 	void (*system_maintenance)(bool);
 	void *label;
 	void (*set_text)(void *, const char *);
@@ -38,6 +38,9 @@
 #define XUSB_LINK_TRB_IDX (XUSB_TRB_SLOTS - 1)
 #define XUSB_LAST_TRB_IDX (XUSB_TRB_SLOTS - 1)
 
+#define XUSB_TRB_BOUNDARY 0x10000
+#define XUSB_TD_MAX_TRBS  (USB_EP_VEC_MAX_SIZE / XUSB_TRB_BOUNDARY)
+
 #define EP_DONT_RING     0
 #define EP_RING_DOORBELL 1
 
@@ -927,6 +930,15 @@ int xusb_device_init()
 	return USB_RES_OK;
 }
 
+static void _xusb_ring_doorbell(int ep_idx)
+{
+	bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
+	u32 target_id = (ep_idx << 8) & 0xFFFF;
+	if (ep_idx == XUSB_EP_CTRL_IN)
+		target_id |= usbd_xotg->ctrl_seq_num << 16;
+	XUSB_DEV_XHCI(XUSB_DEV_XHCI_DB) = target_id;
+}
+
 static int _xusb_queue_trb(int ep_idx, void *trb, bool ring_doorbell)
 {
 	int res = USB_RES_OK;
@@ -962,6 +974,7 @@ static int _xusb_queue_trb(int ep_idx, void *trb, bool ring_doorbell)
 			link_trb = (link_trb_t *)next_trb;
 			link_trb->cycle = usbd_xotg->bulkout_producer_cycle & 1;
 			link_trb->toggle_cycle = 1;
+			link_trb->chain = ((normal_trb_t *)trb)->chain; // Keep TD chained.
 			next_trb = (data_trb_t *)(link_trb->ring_seg_ptrlo << 4);
 			usbd_xotg->bulkout_producer_cycle ^= 1;
 		}
@@ -978,6 +991,7 @@ static int _xusb_queue_trb(int ep_idx, void *trb, bool ring_doorbell)
 			link_trb = (link_trb_t *)next_trb;
 			link_trb->cycle = usbd_xotg->bulkin_producer_cycle & 1;
 			link_trb->toggle_cycle = 1;
+			link_trb->chain = ((normal_trb_t *)trb)->chain; // Keep TD chained.
 			next_trb = (data_trb_t *)(link_trb->ring_seg_ptrlo << 4);
 			usbd_xotg->bulkin_producer_cycle ^= 1;
 		}
@@ -992,13 +1006,7 @@ static int _xusb_queue_trb(int ep_idx, void *trb, bool ring_doorbell)
 
 	// Ring doorbell.
 	if (ring_doorbell)
-	{
-		bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
-		u32 target_id = (ep_idx << 8) & 0xFFFF;
-		if (ep_idx == XUSB_EP_CTRL_IN)
-			target_id |= usbd_xotg->ctrl_seq_num << 16;
-		XUSB_DEV_XHCI(XUSB_DEV_XHCI_DB) = target_id;
-	}
+		_xusb_ring_doorbell(ep_idx);
 
 	return res;
 }
@@ -1011,7 +1019,7 @@ static void _xusb_create_status_trb(status_trb_t *trb, usb_dir_t direction)
 	trb->dir = direction;
 }
 
-static void _xusb_create_normal_trb(normal_trb_t *trb, u8 *buf, u32 len, usb_dir_t direction)
+static void _xusb_create_normal_trb(normal_trb_t *trb, u8 *buf, u32 len, usb_dir_t direction, bool chain)
 {
 	u8 producer_cycle;
 
@@ -1020,9 +1028,9 @@ static void _xusb_create_normal_trb(normal_trb_t *trb, u8 *buf, u32 len, usb_dir
 
 	trb->trb_tx_len = len;
 
-	// Single TRB transfer.
+	// Chained TRBs only interrupt on the last one of the TD.
 	trb->td_size = 0;
-	trb->chain = 0;
+	trb->chain = chain;
 
 	if (direction == USB_DIR_IN)
 		producer_cycle = usbd_xotg->bulkin_producer_cycle & 1;
@@ -1031,7 +1039,7 @@ static void _xusb_create_normal_trb(normal_trb_t *trb, u8 *buf, u32 len, usb_dir
 
 	trb->cycle = producer_cycle;
 	trb->isp = 1; // Enable interrupt on short packet.
-	trb->ioc = 1; // Enable interrupt on completion.
+	trb->ioc = !chain; // Enable interrupt on completion.
 	trb->trb_type = XUSB_TRB_NORMAL;
 }
 
@@ -1072,7 +1080,7 @@ static int _xusb_issue_normal_trb(u8 *buf, u32 len, usb_dir_t direction)
 {
 	normal_trb_t trb = {0};
 
-	_xusb_create_normal_trb(&trb, buf, len, direction);
+	_xusb_create_normal_trb(&trb, buf, len, direction, false);
 	int ep_idx = USB_EP_BULK_IN;
 	if (direction == USB_DIR_OUT)
 		ep_idx = USB_EP_BULK_OUT;
@@ -1083,6 +1091,80 @@ static int _xusb_issue_normal_trb(u8 *buf, u32 len, usb_dir_t direction)
 	return res;
 }
 
+static u32 _xusb_vec_trbs(const usb_xfer_vec_t *vec, u32 cnt, u32 *len)
+{
+	u32 trbs = 0;
+	*len = 0;
+
+	// TRB buffers must not cross a 64KB boundary.
+	for (u32 i = 0; i < cnt; i++)
+	{
+		if (!vec[i].len)
+			continue;
+
+		u32 start = (u32)vec[i].buf;
+		trbs += ((start + vec[i].len - 1) / XUSB_TRB_BOUNDARY) - (start / XUSB_TRB_BOUNDARY) + 1;
+		*len += vec[i].len;
+	}
+
+	return trbs;
+}
+
+static int _xusb_issue_normal_trb_vec(const usb_xfer_vec_t *vec, u32 cnt, usb_dir_t direction)
+{
+	normal_trb_t trb = {0};
+	data_trb_t *first_trb;
+	u32 first_cycle;
+	u32 len;
+
+	u32 trbs = _xusb_vec_trbs(vec, cnt, &len);
+	if (!trbs || trbs > XUSB_TD_MAX_TRBS)
+		return USB_ERROR_XFER_ERROR;
+
+	int ep_idx = USB_EP_BULK_IN;
+	if (direction == USB_DIR_OUT)
+	{
+		ep_idx = USB_EP_BULK_OUT;
+		first_trb = usbd_xotg->bulkout_epenqueue_ptr;
+		first_cycle = usbd_xotg->bulkout_producer_cycle & 1;
+	}
+	else
+	{
+		first_trb = usbd_xotg->bulkin_epenqueue_ptr;
+		first_cycle = usbd_xotg->bulkin_producer_cycle & 1;
+	}
+
+	usbd_xotg->bytes_remaining[direction] = len;
+
+	// Chain all TRBs in one TD. First one is handed over last, so the TD is never seen partially.
+	bool first = true;
+	for (u32 i = 0; i < cnt; i++)
+	{
+		u8 *buf = vec[i].buf;
+		u32 buf_len = vec[i].len;
+		while (buf_len)
+		{
+			u32 len_trb = MIN(buf_len, XUSB_TRB_BOUNDARY - ((u32)buf % XUSB_TRB_BOUNDARY));
+			trbs--;
+
+			_xusb_create_normal_trb(&trb, buf, len_trb, direction, trbs != 0);
+			if (first)
+				trb.cycle ^= 1;
+			_xusb_queue_trb(ep_idx, &trb, EP_DONT_RING);
+
+			first = false;
+			buf += len_trb;
+			buf_len -= len_trb;
+		}
+	}
+
+	first_trb->cycle = first_cycle;
+	_xusb_ring_doorbell(ep_idx);
+	usbd_xotg->wait_for_event_trb = XUSB_TRB_NORMAL;
+
+	return USB_RES_OK;
+}
+
 static int _xusb_issue_data_trb(u8 *buf, u32 len, usb_dir_t direction)
 {
 	data_trb_t trb = {0};
@@ -1117,29 +1199,59 @@ int xusb_set_ep_stall(u32 endpoint, int ep_stall)
 	return USB_RES_OK;
 }
 
+static data_trb_t *_xusb_next_trb(data_trb_t *trb)
+{
+	data_trb_t *next_trb = &trb[1];
+	if (next_trb->trb_type == XUSB_TRB_LINK)
+		next_trb = (data_trb_t *)(next_trb->databufptr_lo & 0xFFFFFFF0);
+
+	return next_trb;
+}
+
+static bool _xusb_bulk_td_dequeue(data_trb_t **dequeue_ptr, data_trb_t *enqueue_ptr, transfer_event_trb_t *trb, u32 *skipped)
+{
+	data_trb_t *event_trb = (data_trb_t *)(trb->trb_pointer_lo & 0xFFFFFFF0);
+	data_trb_t *curr_trb = *dequeue_ptr;
+
+	// Check that the event is for a queued TRB. A short packet can also report the end of its TD.
+	while (curr_trb != event_trb)
+	{
+		if (curr_trb == enqueue_ptr)
+			return false;
+		curr_trb = _xusb_next_trb(curr_trb);
+	}
+	if (curr_trb == enqueue_ptr)
+		return false;
+
+	// If TD ended early, skip its remaining chained TRBs.
+	*skipped = 0;
+	while (curr_trb->chain)
+	{
+		curr_trb = _xusb_next_trb(curr_trb);
+		*skipped += curr_trb->trb_tx_len;
+	}
+
+	*dequeue_ptr = _xusb_next_trb(curr_trb);
+
+	return true;
+}
+
 static int _xusb_handle_transfer_event(transfer_event_trb_t *trb)
 {
 	// Advance dequeue list.
-	data_trb_t *next_trb;
+	u32 skipped = 0;
 	switch (trb->ep_id)
 	{
 	case XUSB_EP_CTRL_IN:
-		next_trb = &usbd_xotg->cntrl_epdequeue_ptr[1];
-		if (next_trb->trb_type == XUSB_TRB_LINK)
-			next_trb = (data_trb_t *)(next_trb->databufptr_lo & 0xFFFFFFF0);
-		usbd_xotg->cntrl_epdequeue_ptr = next_trb;
+		usbd_xotg->cntrl_epdequeue_ptr = _xusb_next_trb(usbd_xotg->cntrl_epdequeue_ptr);
 		break;
 	case USB_EP_BULK_OUT:
-		next_trb = &usbd_xotg->bulkout_epdequeue_ptr[1];
-		if (next_trb->trb_type == XUSB_TRB_LINK)
-			next_trb = (data_trb_t *)(next_trb->databufptr_lo & 0xFFFFFFF0);
-		usbd_xotg->bulkout_epdequeue_ptr = next_trb;
+		if (!_xusb_bulk_td_dequeue(&usbd_xotg->bulkout_epdequeue_ptr, usbd_xotg->bulkout_epenqueue_ptr, trb, &skipped))
+			return USB_RES_OK; // Already handled.
 		break;
 	case USB_EP_BULK_IN:
-		next_trb = &usbd_xotg->bulkin_epdequeue_ptr[1];
-		if (next_trb->trb_type == XUSB_TRB_LINK)
-			next_trb = (data_trb_t *)(next_trb->databufptr_lo & 0xFFFFFFF0);
-		usbd_xotg->bulkin_epdequeue_ptr = next_trb;
+		if (!_xusb_bulk_td_dequeue(&usbd_xotg->bulkin_epdequeue_ptr, usbd_xotg->bulkin_epenqueue_ptr, trb, &skipped))
+			return USB_RES_OK; // Already handled.
 		break;
 	default:
 		// Should never happen.
@@ -1170,18 +1282,18 @@ static int _xusb_handle_transfer_event(transfer_event_trb_t *trb)
 			break;
 
 		case USB_EP_BULK_IN:
-			usbd_xotg->bytes_remaining[USB_DIR_IN] -= trb->trb_tx_len;
+			usbd_xotg->bytes_remaining[USB_DIR_IN] -= trb->trb_tx_len + skipped;
 			if (usbd_xotg->tx_count[USB_DIR_IN])///////////
 				usbd_xotg->tx_count[USB_DIR_IN]--;
 
 			// If bytes remaining for a Bulk IN transfer, return error.
-			if (trb->trb_tx_len)
+			if (trb->trb_tx_len || skipped)
 				return XUSB_ERROR_XFER_BULK_IN_RESIDUE;
 			break;
 
 		case USB_EP_BULK_OUT:
 			// If short packet and Bulk OUT, it's not an error because we prime EP for 4KB.
-			usbd_xotg->bytes_remaining[USB_DIR_OUT] -= trb->trb_tx_len;
+			usbd_xotg->bytes_remaining[USB_DIR_OUT] -= trb->trb_tx_len + skipped;
 			if (usbd_xotg->tx_count[USB_DIR_OUT])///////////
 				usbd_xotg->tx_count[USB_DIR_OUT]--;
 			break;
@@ -1873,6 +1985,28 @@ int xusb_device_ep1_out_read(u8 *buf, u32 len, u32 *bytes_read, u32 sync_tries)
 	return res;
 }
 
+int xusb_device_ep1_out_readv(const usb_xfer_vec_t *vec, u32 cnt, u32 *bytes_read, u32 sync_tries)
+{
+	usbd_xotg->tx_count[USB_DIR_OUT] = 0;
+	int res = _xusb_issue_normal_trb_vec(vec, cnt, USB_DIR_OUT);
+	if (res)
+		return res;
+	usbd_xotg->tx_count[USB_DIR_OUT]++;
+
+	if (sync_tries)
+	{
+		while (!res && usbd_xotg->tx_count[USB_DIR_OUT])
+			res = _xusb_ep_operation(sync_tries);
+
+		if (bytes_read)
+			*bytes_read = res ? 0 : usbd_xotg->bytes_remaining[USB_DIR_OUT];
+
+		bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
+	}
+
+	return res;
+}
+
 int xusb_device_ep1_out_read_big(u8 *buf, u32 len, u32 *bytes_read)
 {
 	if (len > USB_EP_BULK_OUT_MAX_XFER)
@@ -1882,17 +2016,23 @@ int xusb_device_ep1_out_read_big(u8 *buf, u32 len, u32 *bytes_read)
 	*bytes_read = 0;
 	u8 *buf_curr = buf;
 
+	// Receive in chained TDs to lower doorbells and interrupts.
 	while (len)
 	{
-		u32 len_ep = MIN(len, USB_EP_BUFFER_MAX_SIZE);
+		usb_xfer_vec_t vec;
+		vec.buf = buf_curr;
+		vec.len = MIN(len, USB_EP_VEC_MAX_SIZE - ((u32)buf_curr % XUSB_TRB_BOUNDARY));
 
-		int res = xusb_device_ep1_out_read(buf_curr, len_ep, &bytes, USB_XFER_SYNCED_DATA);
+		int res = xusb_device_ep1_out_readv(&vec, 1, &bytes, USB_XFER_SYNCED_DATA);
 		if (res)
 			return res;
 
-		len -= len_ep;
-		buf_curr += len_ep;
 		*bytes_read = *bytes_read + bytes;
+		if (bytes < vec.len)
+			break;
+
+		len -= vec.len;
+		buf_curr += vec.len;
 	}
 
 	return USB_RES_OK;
@@ -1912,6 +2052,24 @@ int xusb_device_ep1_out_reading_finish(u32 *pending_bytes)
 	return res;
 }
 
+int xusb_device_ep1_out_reading_wait(u32 *pending_bytes, u32 sync_tries)
+{
+	int res = USB_RES_OK;
+	while (!res && usbd_xotg->tx_count[USB_DIR_OUT])
+		res = _xusb_ep_operation(sync_tries);
+
+	// On timeout the transfer stays queued and can be waited again.
+	if (res == USB_ERROR_TIMEOUT)
+		return res;
+
+	if (pending_bytes)
+		*pending_bytes = res ? 0 : usbd_xotg->bytes_remaining[USB_DIR_OUT];
+
+	bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
+
+	return res;
+}
+
 int xusb_device_ep1_in_write(u8 *buf, u32 len, u32 *bytes_written, u32 sync_tries)
 {
 	if (len > USB_EP_BUFFER_MAX_SIZE)
@@ -1947,6 +2105,28 @@ int xusb_device_ep1_in_write(u8 *buf, u32 len, u32 *bytes_written, u32 sync_trie
 	return res;
 }
 
+int xusb_device_ep1_in_writev(const usb_xfer_vec_t *vec, u32 cnt, u32 *bytes_written, u32 sync_tries)
+{
+	bpmp_mmu_maintenance(BPMP_MMU_MAINT_CLN_INV_WAY, false);
+
+	usbd_xotg->tx_count[USB_DIR_IN] = 0;
+	int res = _xusb_issue_normal_trb_vec(vec, cnt, USB_DIR_IN);
+	if (res)
+		return res;
+	usbd_xotg->tx_count[USB_DIR_IN]++;
+
+	if (sync_tries)
+	{
+		while (!res && usbd_xotg->tx_count[USB_DIR_IN])
+			res = _xusb_ep_operation(sync_tries);
+
+		if (bytes_written)
+			*bytes_written = res ? 0 : usbd_xotg->bytes_remaining[USB_DIR_IN];
+	}
+
+	return res;
+}
+
 int xusb_device_ep1_in_writing_finish(u32 *pending_bytes)
 {
 	int res = USB_RES_OK;
@@ -2021,6 +2201,9 @@ void xusb_device_get_ops(usb_ops_t *ops)
 	ops->usb_device_ep1_out_read           = xusb_device_ep1_out_read;
 	ops->usb_device_ep1_out_read_big       = xusb_device_ep1_out_read_big;
 	ops->usb_device_ep1_out_reading_finish = xusb_device_ep1_out_reading_finish;
+	ops->usb_device_ep1_out_reading_wait   = xusb_device_ep1_out_reading_wait;
+	ops->usb_device_ep1_out_readv          = xusb_device_ep1_out_readv;
 	ops->usb_device_ep1_in_write           = xusb_device_ep1_in_write;
 	ops->usb_device_ep1_in_writing_finish  = xusb_device_ep1_in_writing_finish;
+	ops->usb_device_ep1_in_writev          = xusb_device_ep1_in_writev;
 }
@@ -0,0 +1,84 @@
+/*
+ * Boot tracer for hekate
+ *
+ * Copyright (c) 2021 CTCaer
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <mem/heap.h>
+#include <utils/btrace.h>
+#include <utils/util.h>
+
+static btrace_t *_btrace = NULL;
+
+void btrace_init(btrace_t *ring)
+{
+	// Keep previous sessions if ring is valid. DRAM survives warm reboots and Nyx reloads.
+	if (ring->magic != BTRACE_MAGIC)
+	{
+		memset(ring, 0, sizeof(btrace_t));
+		ring->magic = BTRACE_MAGIC;
+	}
+
+	_btrace = ring;
+
+	btrace_event("boot", BTRACE_MARK);
+}
+
+void btrace_event(const char *name, u32 type)
+{
+	if (!_btrace)
+		return;
+
+	btrace_event_t *ev = &_btrace->ev[_btrace->idx % BTRACE_MAX_EVENTS];
+
+	ev->ts = get_tmr_us();
+	strncpy(ev->name, name, BTRACE_NAME_LEN - 1);
+	ev->name[BTRACE_NAME_LEN - 1] = 0;
+	ev->type = type;
+
+	_btrace->idx++;
+}
+
+void btrace_begin(const char *name)
+{
+	btrace_event(name, BTRACE_BEGIN);
+}
+
+void btrace_end(const char *name)
+{
+	btrace_event(name, BTRACE_END);
+}
+
+btrace_event_t *btrace_get(btrace_t *ring, u32 *count)
+{
+	if (ring->magic != BTRACE_MAGIC || !ring->idx)
+	{
+		*count = 0;
+		return NULL;
+	}
+
+	// Unroll ring to chronological order.
+	u32 cnt = MIN(ring->idx, BTRACE_MAX_EVENTS);
+	u32 first = ring->idx - cnt;
+	btrace_event_t *events = (btrace_event_t *)malloc(cnt * sizeof(btrace_event_t));
+	for (u32 i = 0; i < cnt; i++)
+		memcpy(&events[i], &ring->ev[(first + i) % BTRACE_MAX_EVENTS], sizeof(btrace_event_t));
+
+	*count = cnt;
+
+	return events;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2021 CTCaer
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BTRACE_H_
+#define _BTRACE_H_
+
+#include <utils/types.h>
+
+#define BTRACE_MAGIC      0x43525442 // "BTRC".
+#define BTRACE_MAX_EVENTS 128 // Must be a power of 2.
+#define BTRACE_NAME_LEN   11 // Including NUL.
+
+typedef enum _btrace_type_t
+{
+	BTRACE_MARK  = 0, // New session. Timestamps of later events are relative to it.
+	BTRACE_BEGIN = 1,
+	BTRACE_END   = 2
+} btrace_type_t;
+
+typedef struct _btrace_event_t
+{
+	u32  ts;
+	char name[BTRACE_NAME_LEN];
+	u8   type;
+} btrace_event_t;
+
+typedef struct _btrace_t
+{
+	u32 magic;
+	u32 idx; // Total events written. Ring slot is idx % BTRACE_MAX_EVENTS.
+	btrace_event_t ev[BTRACE_MAX_EVENTS];
+} btrace_t;
+
+void btrace_init(btrace_t *ring);
+void btrace_event(const char *name, u32 type);
+void btrace_begin(const char *name);
+void btrace_end(const char *name);
+btrace_event_t *btrace_get(btrace_t *ring, u32 *count);
+
+#endif
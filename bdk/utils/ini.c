@@ -1,6 +1,6 @@
 /*
  * Copyright (c) 2018 naehrwert
- * Copyright (c) 2018-2020 CTCaer
+ * Copyright (c) 2018-2021 CTCaer
  *
  * This program is free software; you can redistribute it and/or modify it
  * under the terms and conditions of the GNU General Public License,
@@ -20,7 +20,9 @@
 #include "ini.h"
 #include <libs/fatfs/ff.h>
 #include <mem/heap.h>
+#include <storage/nx_sd.h>
 #include <utils/dirlist.h>
+#include <utils/util.h>
 
 static char *_strdup(char *str)
 {
@@ -187,3 +189,304 @@ char *ini_check_payload_section(ini_sec_t *cfg)
 
 	return NULL;
 }
+
+typedef struct _ini_cache_hdr_t
+{
+	u32 magic;
+	u32 version;
+	u32 stamp; // CRC32 of names, dates and sizes of the ini files.
+	u32 size;
+	u32 secs_cnt;
+	u32 kvs_cnt;
+	u32 keys_cnt;
+	u32 strs_size;
+} ini_cache_hdr_t;
+
+typedef struct _ini_cache_sec_t
+{
+	u32 name; // Offset in strings. INI_CACHE_NO_STR if none.
+	u32 type;
+	u32 color;
+	u32 kvs_cnt;
+} ini_cache_sec_t;
+
+typedef struct _ini_cache_kv_t
+{
+	u32 key; // Index in interned keys.
+	u32 id;  // Resolved key id.
+	u32 val; // Offset in strings.
+} ini_cache_kv_t;
+
+#define INI_CACHE_NO_STR 0xFFFFFFFF
+
+static u32 _ini_cache_stamp_file(u32 crc, char *path)
+{
+	FILINFO fno;
+	u32 stat[3] = { 0 };
+
+	if (!f_stat(path, &fno))
+	{
+		stat[0] = fno.fdate;
+		stat[1] = fno.ftime;
+		stat[2] = fno.fsize;
+	}
+
+	crc = crc32_calc(crc, (const u8 *)path, strlen(path));
+
+	return crc32_calc(crc, (const u8 *)stat, sizeof(stat));
+}
+
+static u32 _ini_cache_stamp(char *ini_path, bool is_dir)
+{
+	if (!is_dir)
+		return _ini_cache_stamp_file(0, ini_path);
+
+	char *filelist = dirlist(ini_path, "*.ini", false, false);
+	if (!filelist)
+		return 0;
+
+	u32 crc = 0;
+	char *path = (char *)malloc(256);
+	for (u32 k = 0; filelist[k * 256]; k++)
+	{
+		strcpy(path, ini_path);
+		strcat(path, "/");
+		strcat(path, &filelist[k * 256]);
+		crc = _ini_cache_stamp_file(crc, path);
+	}
+
+	free(path);
+	free(filelist);
+
+	return crc;
+}
+
+static u32 _ini_cache_str(char *strs, u32 *strs_size, char *str)
+{
+	if (!str)
+		return INI_CACHE_NO_STR;
+
+	u32 off = *strs_size;
+	if (strs)
+		strcpy(strs + off, str);
+	*strs_size += strlen(str) + 1;
+
+	return off;
+}
+
+static u32 _ini_key_id(const char * const *keys, char *key)
+{
+	for (u32 i = 0; keys && keys[i]; i++)
+		if (!strcmp(keys[i], key))
+			return i + 1;
+
+	return INI_KEY_UNKNOWN;
+}
+
+static u8 *_ini_cache_compile(link_t *src, u32 stamp, const char * const *known_keys)
+{
+	ini_cache_hdr_t hdr = { 0 };
+	hdr.magic = INI_CACHE_MAGIC;
+	hdr.version = INI_CACHE_VERSION;
+	hdr.stamp = stamp;
+
+	// Count sections and kvs.
+	LIST_FOREACH_ENTRY(ini_sec_t, csec, src, link)
+	{
+		hdr.secs_cnt++;
+		if (csec->type == INI_CHOICE)
+			LIST_FOREACH_ENTRY(ini_kv_t, kv, &csec->kvs, link)
+				hdr.kvs_cnt++;
+	}
+
+	// Worst case sizes. Every key unique.
+	char **keys = (char **)malloc(sizeof(char *) * (hdr.kvs_cnt + 1));
+	u32 *key_offs = (u32 *)malloc(sizeof(u32) * (hdr.kvs_cnt + 1));
+	u32 *key_ids = (u32 *)malloc(sizeof(u32) * (hdr.kvs_cnt + 1));
+	LIST_FOREACH_ENTRY(ini_sec_t, csec, src, link)
+	{
+		_ini_cache_str(NULL, &hdr.strs_size, csec->name);
+		if (csec->type == INI_CHOICE)
+		{
+			LIST_FOREACH_ENTRY(ini_kv_t, kv, &csec->kvs, link)
+			{
+				_ini_cache_str(NULL, &hdr.strs_size, kv->key);
+				_ini_cache_str(NULL, &hdr.strs_size, kv->val);
+			}
+		}
+	}
+
+	u32 tables_size = sizeof(ini_cache_hdr_t) + hdr.secs_cnt * sizeof(ini_cache_sec_t) +
+		hdr.kvs_cnt * sizeof(ini_cache_kv_t) + hdr.kvs_cnt * sizeof(u32);
+	u8 *buf = (u8 *)calloc(ALIGN(tables_size + hdr.strs_size, 4), 1);
+	ini_cache_sec_t *secs = (ini_cache_sec_t *)(buf + sizeof(ini_cache_hdr_t));
+	ini_cache_kv_t *kvs = (ini_cache_kv_t *)&secs[hdr.secs_cnt];
+	u32 *key_tbl = (u32 *)&kvs[hdr.kvs_cnt];
+	char *strs = (char *)&key_tbl[hdr.kvs_cnt];
+	u32 strs_size = 0;
+
+	// Serialize sections and kvs. Keys are interned and resolved to ids once.
+	LIST_FOREACH_ENTRY(ini_sec_t, csec, src, link)
+	{
+		secs->name = _ini_cache_str(strs, &strs_size, csec->name);
+		secs->type = csec->type;
+		secs->color = csec->color;
+		if (csec->type == INI_CHOICE)
+		{
+			LIST_FOREACH_ENTRY(ini_kv_t, kv, &csec->kvs, link)
+			{
+				u32 key;
+				for (key = 0; key < hdr.keys_cnt; key++)
+					if (!strcmp(keys[key], kv->key))
+						break;
+
+				if (key == hdr.keys_cnt)
+				{
+					keys[key] = kv->key;
+					key_offs[key] = _ini_cache_str(strs, &strs_size, kv->key);
+					key_ids[key] = _ini_key_id(known_keys, kv->key);
+					hdr.keys_cnt++;
+				}
+
+				kv->id = key_ids[key];
+				kvs->key = key;
+				kvs->id = key_ids[key];
+				kvs->val = _ini_cache_str(strs, &strs_size, kv->val);
+				kvs++;
+				secs->kvs_cnt++;
+			}
+		}
+		secs++;
+	}
+
+	// Place strings after the used part of the key table.
+	memcpy(key_tbl, key_offs, hdr.keys_cnt * sizeof(u32));
+	memmove(&key_tbl[hdr.keys_cnt], strs, strs_size);
+	hdr.strs_size = strs_size;
+	hdr.size = ALIGN(tables_size - (hdr.kvs_cnt - hdr.keys_cnt) * sizeof(u32) + strs_size, 4);
+	memcpy(buf, &hdr, sizeof(ini_cache_hdr_t));
+
+	free(keys);
+	free(key_offs);
+	free(key_ids);
+
+	return buf;
+}
+
+static int _ini_cache_load(link_t *dst, u8 *buf, u32 size, u32 stamp)
+{
+	ini_cache_hdr_t *hdr = (ini_cache_hdr_t *)buf;
+
+	if (size < sizeof(ini_cache_hdr_t) ||
+		hdr->magic != INI_CACHE_MAGIC || hdr->version != INI_CACHE_VERSION ||
+		hdr->stamp != stamp || hdr->size != size)
+		return 0;
+
+	ini_cache_sec_t *secs = (ini_cache_sec_t *)(buf + sizeof(ini_cache_hdr_t));
+	ini_cache_kv_t *kvs = (ini_cache_kv_t *)&secs[hdr->secs_cnt];
+	u32 *key_tbl = (u32 *)&kvs[hdr->kvs_cnt];
+	char *strs = (char *)&key_tbl[hdr->keys_cnt];
+
+	if ((u8 *)strs + hdr->strs_size > buf + size)
+		return 0;
+
+	// Strings point directly in the cache buffer. No per string allocations.
+	ini_sec_t *csecs = (ini_sec_t *)calloc(hdr->secs_cnt, sizeof(ini_sec_t));
+	ini_kv_t *ckvs = (ini_kv_t *)calloc(hdr->kvs_cnt, sizeof(ini_kv_t));
+
+	for (u32 i = 0; i < hdr->secs_cnt; i++, secs++)
+	{
+		ini_sec_t *csec = &csecs[i];
+		csec->name = secs->name != INI_CACHE_NO_STR ? strs + secs->name : NULL;
+		csec->type = secs->type;
+		csec->color = secs->color;
+		if (csec->type == INI_CHOICE)
+			list_init(&csec->kvs);
+
+		for (u32 j = 0; j < secs->kvs_cnt; j++, kvs++, ckvs++)
+		{
+			ckvs->key = strs + key_tbl[kvs->key];
+			ckvs->id = kvs->id;
+			ckvs->val = strs + kvs->val;
+			list_append(&csec->kvs, &ckvs->link);
+		}
+
+		list_append(dst, &csec->link);
+	}
+
+	return 1;
+}
+
+static void _ini_index_build(link_t *src, ini_index_t *idx)
+{
+	u32 secs_cnt = 0;
+	u32 choices_cnt = 0;
+
+	memset(idx, 0, sizeof(ini_index_t));
+	LIST_FOREACH_ENTRY(ini_sec_t, csec, src, link)
+	{
+		secs_cnt++;
+		if (csec->type == INI_CHOICE)
+			choices_cnt++;
+	}
+
+	// One allocation for all tables. Entries are never more than choices.
+	idx->secs = (ini_sec_t **)malloc(sizeof(ini_sec_t *) * (secs_cnt + choices_cnt * 2 + 1));
+	idx->choices = &idx->secs[secs_cnt];
+	idx->entries = &idx->choices[choices_cnt];
+	idx->config_pos = choices_cnt;
+
+	LIST_FOREACH_ENTRY(ini_sec_t, csec, src, link)
+	{
+		idx->secs[idx->secs_cnt++] = csec;
+		if (csec->type != INI_CHOICE)
+			continue;
+
+		if (!strcmp(csec->name, "config"))
+		{
+			if (idx->config_pos == choices_cnt)
+				idx->config_pos = idx->choices_cnt;
+		}
+		else
+			idx->entries[idx->entries_cnt++] = csec;
+
+		idx->choices[idx->choices_cnt++] = csec;
+	}
+}
+
+void ini_free(ini_index_t *idx)
+{
+	free(idx->secs);
+	memset(idx, 0, sizeof(ini_index_t));
+}
+
+int ini_parse_cached(link_t *dst, char *ini_path, bool is_dir, char *cache_path, const char * const *keys, ini_index_t *idx)
+{
+	u32 stamp = _ini_cache_stamp(ini_path, is_dir);
+
+	// Key ids are stored in the cache, so a different key table must rebuild it.
+	for (u32 i = 0; keys && keys[i]; i++)
+		stamp = crc32_calc(stamp, (const u8 *)keys[i], strlen(keys[i]) + 1);
+
+	// Use the pre-tokenized cache if no ini file was changed.
+	u32 size = 0;
+	u8 *buf = (u8 *)sd_file_read(cache_path, &size);
+	if (!buf || !_ini_cache_load(dst, buf, size, stamp))
+	{
+		free(buf);
+
+		// Otherwise parse the ini files and rebuild it.
+		if (!ini_parse(dst, ini_path, is_dir))
+			return 0;
+
+		buf = _ini_cache_compile(dst, stamp, keys);
+		f_mkdir("bootloader/cache");
+		sd_save_to_file(buf, ((ini_cache_hdr_t *)buf)->size, cache_path);
+		free(buf);
+	}
+
+	if (idx)
+		_ini_index_build(dst, idx);
+
+	return 1;
+}
@@ -27,10 +27,16 @@
 #define INI_NEWLINE 0xFE
 #define INI_COMMENT 0xFF
 
+#define INI_CACHE_MAGIC   0x30434E49 // "INC0".
+#define INI_CACHE_VERSION 2
+
+#define INI_KEY_UNKNOWN 0
+
 typedef struct _ini_kv_t
 {
 	char *key;
 	char *val;
+	u32 id; // Position in the key table + 1. INI_KEY_UNKNOWN if not there.
 	link_t link;
 } ini_kv_t;
 
@@ -43,7 +49,20 @@ typedef struct _ini_sec_t
 	u32 color;
 } ini_sec_t;
 
+typedef struct _ini_index_t
+{
+	ini_sec_t **secs;        // All sections in order.
+	u32         secs_cnt;
+	ini_sec_t **choices;     // Boot entries and [config] sections in order. Index is the boot entry id.
+	u32         choices_cnt;
+	ini_sec_t **entries;     // Boot entries in order, excluding [config].
+	u32         entries_cnt;
+	u32         config_pos;  // Index of the first [config] in choices. choices_cnt if none.
+} ini_index_t;
+
 int ini_parse(link_t *dst, char *ini_path, bool is_dir);
+int ini_parse_cached(link_t *dst, char *ini_path, bool is_dir, char *cache_path, const char * const *keys, ini_index_t *idx);
+void ini_free(ini_index_t *idx);
 char *ini_check_payload_section(ini_sec_t *cfg);
 
 #endif
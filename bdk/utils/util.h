@@ -20,6 +20,7 @@
 
 #include <utils/types.h>
 #include <mem/minerva.h>
+#include <utils/btrace.h>
 
 #define NYX_NEW_INFO 0x3058594E
 
@@ -67,7 +68,8 @@ typedef struct _nyx_info_t
 	u32 magic;
 	u32 sd_init;
 	u32 sd_errors[3];
-	u8  rsvd[0x1000];
+	btrace_t trace;
+	u8  rsvd[0x1000 - sizeof(btrace_t)];
 	u32 disp_id;
 	u32 errors;
 } nyx_info_t;
@@ -154,6 +154,10 @@ int create_config_entry()
 	}
 
 	f_close(&fp);
+
+	// No RTC, so date might not change. Force a rebuild of the config cache.
+	f_unlink("bootloader/cache/hekate_ipl.bin");
+
 	sd_end();
 
 	return 0;
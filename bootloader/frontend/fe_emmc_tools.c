@@ -478,7 +478,7 @@ static void _dump_emmc_selected(emmcPartType_t dumpType)
 	// Get SD Card free space for Partial Backup.
 	f_getfree("", &sd_fs.free_clst, NULL);
 
-	sdmmc_storage_t storage;
+	sdmmc_storage_t storage = { 0 };
 	sdmmc_t sdmmc;
 	if (!sdmmc_storage_init_mmc(&storage, &sdmmc, SDMMC_BUS_WIDTH_8, SDHCI_TIMING_MMC_HS400))
 	{
@@ -829,7 +829,7 @@ static void _restore_emmc_selected(emmcPartType_t restoreType)
 	if (!sd_mount())
 		goto out;
 
-	sdmmc_storage_t storage;
+	sdmmc_storage_t storage = { 0 };
 	sdmmc_t sdmmc;
 	if (!sdmmc_storage_init_mmc(&storage, &sdmmc, SDMMC_BUS_WIDTH_8, SDHCI_TIMING_MMC_HS400))
 	{
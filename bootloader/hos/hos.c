@@ -21,6 +21,7 @@
 #include <string.h>
 
 #include "hos.h"
+#include "hos_cache.h"
 #include "hos_config.h"
 #include "sept.h"
 #include "secmon_exo.h"
@@ -46,6 +47,7 @@
 #include <storage/nx_sd.h>
 #include <storage/sdmmc.h>
 #include <utils/btn.h>
+#include <utils/btrace.h>
 #include <utils/util.h>
 
 extern hekate_config h_cfg;
@@ -733,6 +735,8 @@ int hos_launch(ini_sec_t *cfg)
 
 	ctxt.cfg = cfg;
 
+	btrace_begin("hos");
+
 	if (!gfx_con.mute)
 		gfx_clear_grey(0x1B);
 	gfx_con_setpos(0, 0);
@@ -740,7 +744,9 @@ int hos_launch(ini_sec_t *cfg)
 	gfx_puts("Initializing...\n\n");
 
 	// Initialize eMMC/emuMMC.
+	btrace_begin("emmc_init");
 	int res = emummc_storage_init_mmc();
+	btrace_end("emmc_init");
 	if (res)
 	{
 		if (res == 2)
@@ -756,17 +762,21 @@ int hos_launch(ini_sec_t *cfg)
 		_hos_crit_error("SD has GPT only!");
 
 	// Read package1 and the correct keyblob.
+	btrace_begin("pkg1_read");
 	if (!_read_emmc_pkg1(&ctxt))
 		goto error;
+	btrace_end("pkg1_read");
 
 	kb = ctxt.pkg1_id->kb;
 
-	// Try to parse config if present.
+	// Try to parse config if present. This also loads fss0.
+	btrace_begin("config");
 	if (ctxt.cfg && !parse_boot_config(&ctxt))
 	{
 		_hos_crit_error("Wrong ini cfg or missing files!");
 		goto error;
 	}
+	btrace_end("config");
 
 	bool emummc_enabled = emu_cfg.enabled && !h_cfg.emummc_force_disable;
 
@@ -833,8 +843,10 @@ int hos_launch(ini_sec_t *cfg)
 			goto error;
 		}
 
+		btrace_begin("keygen");
 		if (!hos_keygen(ctxt.keyblob, kb, &tsec_ctxt, &ctxt))
 			goto error;
+		btrace_end("keygen");
 		gfx_puts("Generated keys\n");
 		if (kb <= KB_FIRMWARE_VERSION_600)
 			h_cfg.se_keygen_done = 1;
@@ -913,16 +925,23 @@ int hos_launch(ini_sec_t *cfg)
 	gfx_puts("Loaded warmboot and secmon\n");
 
 	// Read package2.
+	btrace_begin("pkg2_read");
 	u8 *bootConfigBuf = _read_emmc_pkg2(&ctxt);
 	if (!bootConfigBuf)
 	{
 		_hos_crit_error("Pkg2 read failed!");
 		goto error;
 	}
+	btrace_end("pkg2_read");
 
 	gfx_puts("Read pkg2\n");
 
+	// Get the cache key from encrypted package2 and config.
+	if (ctxt.kip_cache)
+		hos_cache_key(&ctxt);
+
 	// Decrypt package2 and parse KIP1 blobs in INI1 section.
+	btrace_begin("pkg2_dec");
 	pkg2_hdr_t *pkg2_hdr = pkg2_decrypt(ctxt.pkg2, kb);
 	if (!pkg2_hdr)
 	{
@@ -943,9 +962,21 @@ int hos_launch(ini_sec_t *cfg)
 		_hos_crit_error("INI1 parsing failed!");
 		goto error;
 	}
+	btrace_end("pkg2_dec");
 
 	gfx_puts("Parsed ini1\n");
 
+	// Use cached patched kernel and kips if firmware and config are unchanged.
+	bool exfat_compat = true;
+	if (ctxt.kip_cache)
+	{
+		btrace_begin("kip_cache");
+		ctxt.kip_cache_hit = hos_cache_load(&ctxt, &kip1_info, &exfat_compat);
+		btrace_end("kip_cache");
+		if (ctxt.kip_cache_hit)
+			gfx_puts("Loaded cached kernel & kips\n");
+	}
+
 	// Use the kernel included in package2 in case we didn't load one already.
 	if (!ctxt.kernel)
 	{
@@ -996,13 +1027,17 @@ int hos_launch(ini_sec_t *cfg)
 	}
 
 	// Merge extra KIP1s into loaded ones.
-	LIST_FOREACH_ENTRY(merge_kip_t, mki, &ctxt.kip1_list, link)
-		pkg2_merge_kip(&kip1_info, (pkg2_kip1_t *)mki->kip1);
+	if (!ctxt.kip_cache_hit)
+		LIST_FOREACH_ENTRY(merge_kip_t, mki, &ctxt.kip1_list, link)
+			pkg2_merge_kip(&kip1_info, (pkg2_kip1_t *)mki->kip1);
 
 	// Check if FS is compatible with exFAT and if 5.1.0.
-	if (!ctxt.stock && (sd_fs.fs_type == FS_EXFAT || kb == KB_FIRMWARE_VERSION_500))
+	// Always checked when caching, since the result is reused even if SD filesystem changes.
+	if (!ctxt.stock && (sd_fs.fs_type == FS_EXFAT || kb == KB_FIRMWARE_VERSION_500 || ctxt.kip_cache))
 	{
-		bool exfat_compat = _get_fs_exfat_compatible(&kip1_info, &ctxt.exo_ctx.fs_is_510);
+		// Cached kips are patched, so the cached result is used.
+		if (!ctxt.kip_cache_hit)
+			exfat_compat = _get_fs_exfat_compatible(&kip1_info, &ctxt.exo_ctx.fs_is_510);
 
 		if (sd_fs.fs_type == FS_EXFAT && !exfat_compat)
 		{
@@ -1014,9 +1049,15 @@ int hos_launch(ini_sec_t *cfg)
 	}
 
 	// Patch kip1s in memory if needed.
-	if (ctxt.kip1_patches)
-		gfx_printf("%kPatching kips%k\n", 0xFFFFBA00, 0xFFCCCCCC);
-	const char* unappliedPatch = pkg2_patch_kips(&kip1_info, ctxt.kip1_patches);
+	const char* unappliedPatch = NULL;
+	if (!ctxt.kip_cache_hit)
+	{
+		if (ctxt.kip1_patches)
+			gfx_printf("%kPatching kips%k\n", 0xFFFFBA00, 0xFFCCCCCC);
+		btrace_begin("kip_patch");
+		unappliedPatch = pkg2_patch_kips(&kip1_info, ctxt.kip1_patches);
+		btrace_end("kip_patch");
+	}
 	if (unappliedPatch != NULL)
 	{
 		EHPRINTFARGS("Failed to apply '%s'!", unappliedPatch);
@@ -1034,9 +1075,18 @@ int hos_launch(ini_sec_t *cfg)
 			goto error; // MUST stop here, because if user requests 'nogc' but it's not applied, their GC controller gets updated!
 		}
 	}
+	else if (ctxt.kip_cache && !ctxt.kip_cache_hit)
+	{
+		// Save patched kernel and kips for next boots.
+		btrace_begin("kip_save");
+		hos_cache_save(&ctxt, &kip1_info, exfat_compat);
+		btrace_end("kip_save");
+	}
 
 	// Rebuild and encrypt package2.
+	btrace_begin("pkg2_build");
 	pkg2_build_encrypt((void *)PKG2_LOAD_ADDR, &ctxt, &kip1_info);
+	btrace_end("pkg2_build");
 
 	gfx_puts("Rebuilt & loaded pkg2\n");
 
@@ -1144,6 +1194,8 @@ int hos_launch(ini_sec_t *cfg)
 	sdmmc_storage_init_wait_sd();
 
 	// Launch secmon.
+	btrace_end("hos");
+	btrace_begin("secmon");
 	if (smmu_is_used())
 		smmu_exit();
 	else
@@ -1155,12 +1207,14 @@ int hos_launch(ini_sec_t *cfg)
 
 	// Signal pkg2 ready and continue boot.
 	secmon_mailbox->in = bootStatePkg2Continue;
+	btrace_end("secmon");
 
 	// Halt ourselves in waitevent state and resume if there's JTAG activity.
 	while (true)
 		bpmp_halt();
 
 error:
+	btrace_end("hos");
 	sdmmc_storage_end(&emmc_storage);
 	h_cfg.aes_slots_new = false;
 	return 0;
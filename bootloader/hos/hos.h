@@ -115,6 +115,10 @@ typedef struct _launch_ctxt_t
 	bool fss0_experimental;
 	bool emummc_forced;
 
+	bool kip_cache;
+	bool kip_cache_hit;
+	u8   kip_cache_key[SE_SHA_256_SIZE];
+
 	exo_ctxt_t exo_ctx;
 
 	ini_sec_t *cfg;
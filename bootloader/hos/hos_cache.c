@@ -0,0 +1,204 @@
+/*
+ * HOS boot artifact cache for hekate
+ *
+ * Copyright (c) 2021 CTCaer
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "hos_cache.h"
+#include "pkg1.h"
+#include "pkg2.h"
+#include <libs/fatfs/ff.h>
+#include <mem/heap.h>
+#include <sec/se.h>
+#include <storage/nx_sd.h>
+#include <utils/ini.h>
+#include <utils/util.h>
+#include "../storage/emummc.h"
+
+#define HOS_CACHE_ALIGN 0x10
+
+static void _hos_cache_path(launch_ctxt_t *ctxt, char *path)
+{
+	// One cache per boot entry. It gets replaced when its key changes.
+	strcpy(path, "bootloader/cache/hos_");
+	itoa(crc32_calc(0, (const u8 *)ctxt->cfg->name, strlen(ctxt->cfg->name)), path + strlen(path), 16);
+	strcat(path, ".bin");
+}
+
+static void _hos_cache_key_add(u8 *key, const void *data, u32 size)
+{
+	u8 buf[SE_SHA_256_SIZE * 2];
+
+	// Chain hashes: key = SHA256(key | SHA256(data)).
+	memcpy(buf, key, SE_SHA_256_SIZE);
+	se_calc_sha256_oneshot(buf + SE_SHA_256_SIZE, data, size);
+	se_calc_sha256_oneshot(key, buf, sizeof(buf));
+}
+
+static void _hos_cache_key_add_file(u8 *key, const char *path)
+{
+	FILINFO fno;
+	u32 stat[2] = { 0 };
+
+	if (!f_stat(path, &fno))
+	{
+		stat[0] = (fno.fdate << 16) | fno.ftime;
+		stat[1] = fno.fsize;
+	}
+
+	_hos_cache_key_add(key, stat, sizeof(stat));
+}
+
+void hos_cache_key(launch_ctxt_t *ctxt)
+{
+	u8 *key = ctxt->kip_cache_key;
+	u32 version = (HOS_CACHE_VERSION << 24) | (BL_VER_MJ << 16) | (BL_VER_MN << 8) | BL_VER_HF;
+
+	// Built-in patches change with hekate version.
+	memset(key, 0, SE_SHA_256_SIZE);
+	_hos_cache_key_add(key, &version, sizeof(version));
+
+	// Firmware. Encrypted package2 must be hashed before decryption.
+	_hos_cache_key_add(key, ctxt->pkg1_id->id, strlen(ctxt->pkg1_id->id) + 1);
+	_hos_cache_key_add(key, ctxt->pkg2, ctxt->pkg2_size);
+
+	// Boot entry and final patch list.
+	LIST_FOREACH_ENTRY(ini_kv_t, kv, &ctxt->cfg->kvs, link)
+	{
+		_hos_cache_key_add(key, kv->key, strlen(kv->key) + 1);
+		_hos_cache_key_add(key, kv->val, strlen(kv->val) + 1);
+	}
+	if (ctxt->kip1_patches)
+		_hos_cache_key_add(key, ctxt->kip1_patches, strlen(ctxt->kip1_patches) + 1);
+
+	// Kernel and KIPs loaded from SD via kernel, kip1 or fss0.
+	if (ctxt->kernel)
+		_hos_cache_key_add(key, ctxt->kernel, ctxt->kernel_size);
+	LIST_FOREACH_ENTRY(merge_kip_t, mki, &ctxt->kip1_list, link)
+		_hos_cache_key_add(key, mki->kip1, pkg2_calc_kip1_size((pkg2_kip1_t *)mki->kip1));
+
+	// External patches and emuMMC code.
+	_hos_cache_key_add_file(key, "bootloader/fspatch.ini");
+	_hos_cache_key_add_file(key, "bootloader/sys/emummc.kipm");
+}
+
+int hos_cache_load(launch_ctxt_t *ctxt, link_t *kips_info, bool *exfat_compat)
+{
+	char path[0x40];
+	u32 size = 0;
+	u8 hash[SE_SHA_256_SIZE];
+
+	_hos_cache_path(ctxt, path);
+	u8 *buf = (u8 *)sd_file_read(path, &size);
+	if (!buf)
+		return 0;
+
+	if (size < sizeof(hos_cache_hdr_t))
+		goto error;
+
+	hos_cache_hdr_t *hdr = (hos_cache_hdr_t *)buf;
+	u8 *kernel = buf + sizeof(hos_cache_hdr_t);
+	u8 *kip = kernel + ALIGN(hdr->kernel_size, HOS_CACHE_ALIGN);
+	u8 *end = kip + hdr->kips_size;
+
+	// Check key and integrity. Any mismatch falls back to the full boot path.
+	if (hdr->magic != HOS_CACHE_MAGIC || hdr->version != HOS_CACHE_VERSION ||
+		memcmp(hdr->key, ctxt->kip_cache_key, SE_SHA_256_SIZE) ||
+		!hdr->kernel_size || size != (u32)(end - buf) ||
+		!se_calc_sha256_oneshot(hash, kernel, size - sizeof(hos_cache_hdr_t)) ||
+		memcmp(hash, hdr->hash, SE_SHA_256_SIZE))
+		goto error;
+
+	// Validate patched KIPs.
+	u8 *kips = kip;
+	for (u32 i = 0; i < hdr->kips_cnt; i++)
+	{
+		if (kip + sizeof(pkg2_kip1_t) > end || kip + pkg2_calc_kip1_size((pkg2_kip1_t *)kip) > end)
+			goto error;
+
+		kip += ALIGN(pkg2_calc_kip1_size((pkg2_kip1_t *)kip), HOS_CACHE_ALIGN);
+	}
+
+	// Replace parsed KIPs with the patched ones.
+	list_init(kips_info);
+	for (u32 i = 0; i < hdr->kips_cnt; i++)
+	{
+		pkg2_kip1_info_t *ki = (pkg2_kip1_info_t *)malloc(sizeof(pkg2_kip1_info_t));
+		ki->kip1 = (pkg2_kip1_t *)kips;
+		ki->size = pkg2_calc_kip1_size(ki->kip1);
+		list_append(kips_info, &ki->link);
+
+		kips += ALIGN(ki->size, HOS_CACHE_ALIGN);
+	}
+
+	ctxt->kernel = kernel;
+	ctxt->kernel_size = hdr->kernel_size;
+	ctxt->exo_ctx.fs_is_510 = hdr->fs_is_510;
+	emu_cfg.fs_ver = hdr->fs_ver; // Set by emuMMC KIP patching, which is skipped.
+	*exfat_compat = hdr->exfat_compat;
+
+	return 1;
+
+error:
+	free(buf);
+
+	return 0;
+}
+
+void hos_cache_save(launch_ctxt_t *ctxt, link_t *kips_info, bool exfat_compat)
+{
+	char path[0x40];
+	u32 size = sizeof(hos_cache_hdr_t) + ALIGN(ctxt->kernel_size, HOS_CACHE_ALIGN);
+	u32 kips_cnt = 0;
+
+	LIST_FOREACH_ENTRY(pkg2_kip1_info_t, ki, kips_info, link)
+	{
+		size += ALIGN(ki->size, HOS_CACHE_ALIGN);
+		kips_cnt++;
+	}
+
+	u8 *buf = (u8 *)calloc(size, 1);
+	hos_cache_hdr_t *hdr = (hos_cache_hdr_t *)buf;
+	u8 *kernel = buf + sizeof(hos_cache_hdr_t);
+	u8 *kip = kernel + ALIGN(ctxt->kernel_size, HOS_CACHE_ALIGN);
+
+	hdr->magic = HOS_CACHE_MAGIC;
+	hdr->version = HOS_CACHE_VERSION;
+	memcpy(hdr->key, ctxt->kip_cache_key, SE_SHA_256_SIZE);
+	hdr->kernel_size = ctxt->kernel_size;
+	hdr->kips_size = size - (u32)(kip - buf);
+	hdr->kips_cnt = kips_cnt;
+	hdr->exfat_compat = exfat_compat;
+	hdr->fs_is_510 = ctxt->exo_ctx.fs_is_510;
+	hdr->fs_ver = emu_cfg.fs_ver;
+
+	memcpy(kernel, ctxt->kernel, ctxt->kernel_size);
+	LIST_FOREACH_ENTRY(pkg2_kip1_info_t, ki, kips_info, link)
+	{
+		memcpy(kip, ki->kip1, ki->size);
+		kip += ALIGN(ki->size, HOS_CACHE_ALIGN);
+	}
+
+	se_calc_sha256_oneshot(hdr->hash, kernel, size - sizeof(hos_cache_hdr_t));
+
+	_hos_cache_path(ctxt, path);
+	f_mkdir("bootloader/cache");
+	sd_save_to_file(buf, size, path);
+
+	free(buf);
+}
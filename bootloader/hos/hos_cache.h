@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2021 CTCaer
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _HOS_CACHE_H_
+#define _HOS_CACHE_H_
+
+#include <sec/se_t210.h>
+#include <utils/types.h>
+#include <utils/list.h>
+
+#include "hos.h"
+
+#define HOS_CACHE_MAGIC   0x30434842 // "BHC0".
+#define HOS_CACHE_VERSION 3
+
+typedef struct _hos_cache_hdr_t
+{
+	u32 magic;
+	u32 version;
+	u8  key[SE_SHA_256_SIZE];  // Firmware and config the artifacts were built from.
+	u8  hash[SE_SHA_256_SIZE]; // Payload integrity.
+	u32 kernel_size;
+	u32 kips_size;
+	u32 kips_cnt;
+	u8  exfat_compat;
+	u8  fs_is_510;
+	u8  fs_ver;    // emuMMC FS version. Only set when FS gets patched.
+	u8  rsvd[9];
+} hos_cache_hdr_t;
+
+void hos_cache_key(launch_ctxt_t *ctxt);
+int  hos_cache_load(launch_ctxt_t *ctxt, link_t *kips_info, bool *exfat_compat);
+void hos_cache_save(launch_ctxt_t *ctxt, link_t *kips_info, bool exfat_compat);
+
+#endif
@@ -190,6 +190,16 @@ static int _config_emummc_forced(launch_ctxt_t *ctxt, const char *value)
 	return 1;
 }
 
+static int _config_kip_cache(launch_ctxt_t *ctxt, const char *value)
+{
+	if (*value == '1')
+	{
+		DPRINTF("Enabled kernel/kip cache\n");
+		ctxt->kip_cache = true;
+	}
+	return 1;
+}
+
 static int _config_atmosphere(launch_ctxt_t *ctxt, const char *value)
 {
 	if (*value == '1')
@@ -289,6 +299,7 @@ static const cfg_handler_t _config_handlers[] = {
 	{ "fss0", _config_fss },
 	{ "exofatal", _config_exo_fatal_payload},
 	{ "emummcforce", _config_emummc_forced },
+	{ "kipcache", _config_kip_cache },
 	{ "nouserexceptions", _config_dis_exo_user_exceptions },
 	{ "userpmu", _config_exo_user_pmu_access },
 	{ "cal0blank", _config_exo_cal0_blanking },
@@ -732,6 +732,7 @@ static kip1_id_t _kip_ids[] =
 
 static kip1_id_t *_kip_id_sets = _kip_ids;
 static u32 _kip_id_sets_cnt = ARRAY_SIZE(_kip_ids);
+static u16 *_kip_id_idx = NULL; // Sorted by name and hash.
 
 void pkg2_get_ids(kip1_id_t **ids, u32 *entries)
 {
@@ -739,114 +740,98 @@ void pkg2_get_ids(kip1_id_t **ids, u32 *entries)
 	*entries = _kip_id_sets_cnt;
 }
 
-static void parse_external_kip_patches()
+static int _kip_id_cmp(const char *name, const u8 *hash, u32 kip_idx)
 {
-	static bool ext_patches_done = false;
+	kip1_id_t *id = &_kip_id_sets[kip_idx];
 
-	if (ext_patches_done)
-		return;
+	int res = strncmp(name, id->name, sizeof(((pkg2_kip1_t *)0)->name));
+	if (!res)
+		res = memcmp(hash, id->hash, sizeof(id->hash));
+
+	return res;
+}
 
-	u32 curr_kip_idx = 0;
-	char path[64];
-	strcpy(path, "bootloader/fspatch.ini");
+static bool _kip_id_find(const char *name, const u8 *hash, u32 cnt, u32 *pos)
+{
+	u32 lo = 0;
+	u32 hi = cnt;
 
-	LIST_INIT(ini_kip_sections);
-	if (ini_patch_parse(&ini_kip_sections, path))
+	// Binary search on ids sorted by name and hash.
+	while (lo < hi)
 	{
-		// Copy ids into a new patchset.
-		_kip_id_sets = calloc(sizeof(kip1_id_t), 256); // Max 256 kip ids.
-		memcpy(_kip_id_sets, _kip_ids, sizeof(_kip_ids));
+		u32 mid = (lo + hi) / 2;
+		if (_kip_id_cmp(name, hash, _kip_id_idx[mid]) > 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
 
-		// Parse patchsets and glue them together.
-		LIST_FOREACH_ENTRY(ini_kip_sec_t, ini_psec, &ini_kip_sections, link)
-		{
-			kip1_id_t* curr_kip = NULL;
-			bool found = false;
-			for (curr_kip_idx = 0; curr_kip_idx < _kip_id_sets_cnt + 1; curr_kip_idx++)
-			{
-				curr_kip = &_kip_id_sets[curr_kip_idx];
+	*pos = lo;
 
-				if (!curr_kip->name)
-					break;
+	return lo < cnt && !_kip_id_cmp(name, hash, _kip_id_idx[lo]);
+}
 
-				if (!strcmp(curr_kip->name, ini_psec->name) && !memcmp(curr_kip->hash, ini_psec->hash, 8))
-				{
-					found = true;
-					break;
-				}
-			}
+static void _kip_id_index_insert(u32 kip_idx, u32 pos, u32 cnt)
+{
+	memmove(&_kip_id_idx[pos + 1], &_kip_id_idx[pos], (cnt - pos) * sizeof(u16));
+	_kip_id_idx[pos] = kip_idx;
+}
 
-			if (!curr_kip)
-				continue;
+static void parse_external_kip_patches()
+{
+	static bool ext_patches_done = false;
 
-			// If not found, create a new empty entry.
-			if (!found)
-			{
-				curr_kip->name = ini_psec->name;
-				memcpy(curr_kip->hash, ini_psec->hash, 8);
-				curr_kip->patchset = calloc(sizeof(kip1_patchset_t), 1);
+	if (ext_patches_done)
+		return;
 
-				_kip_id_sets_cnt++;
-			}
+	u32 pos;
+	u32 ext_ids_cnt;
+	kip1_id_t *ext_ids = ini_patch_cache_load("bootloader/fspatch.ini", "bootloader/cache/fspatch.bin", &ext_ids_cnt);
 
-			kip1_patchset_t *patchsets = (kip1_patchset_t *)calloc(sizeof(kip1_patchset_t), 16); // Max 16 patchsets per kip.
+	if (ext_ids_cnt)
+	{
+		// Copy ids into a new patchset.
+		_kip_id_sets = calloc(sizeof(kip1_id_t), ARRAY_SIZE(_kip_ids) + ext_ids_cnt);
+		memcpy(_kip_id_sets, _kip_ids, sizeof(_kip_ids));
+	}
 
-			u32 curr_patchset_idx;
-			for(curr_patchset_idx = 0; curr_kip->patchset[curr_patchset_idx].name != NULL; curr_patchset_idx++)
-			{
-				patchsets[curr_patchset_idx].name = curr_kip->patchset[curr_patchset_idx].name;
-				patchsets[curr_patchset_idx].patches = curr_kip->patchset[curr_patchset_idx].patches;
-			}
+	// Index ids for lookups.
+	_kip_id_idx = malloc((ARRAY_SIZE(_kip_ids) + ext_ids_cnt) * sizeof(u16));
+	for (u32 i = 0; i < _kip_id_sets_cnt; i++)
+	{
+		_kip_id_find(_kip_id_sets[i].name, _kip_id_sets[i].hash, i, &pos);
+		_kip_id_index_insert(i, pos, i);
+	}
 
-			curr_kip->patchset = patchsets;
-			bool first_ext_patch = true;
-			u32 curr_patch_idx = 0;
+	// Glue external patchsets to their ids.
+	for (u32 i = 0; i < ext_ids_cnt; i++)
+	{
+		kip1_id_t *ext_kip = &ext_ids[i];
 
-			// Parse patches and glue them together to a patchset.
-			kip1_patch_t *patches = calloc(sizeof(kip1_patch_t), 32); // Max 32 patches per set.
-			LIST_FOREACH_ENTRY(ini_patchset_t, pt, &ini_psec->pts, link)
-			{
-				if (first_ext_patch)
-				{
-					first_ext_patch = false;
-					patchsets[curr_patchset_idx].name = malloc(strlen(pt->name) + 1);
-					strcpy(patchsets[curr_patchset_idx].name, pt->name);
-					patchsets[curr_patchset_idx].patches = patches;
-				}
-				else
-				{
-					// Check if new patchset name is found and create a new set.
-					if (strcmp(pt->name, patchsets[curr_patchset_idx].name))
-					{
-						curr_patchset_idx++;
-						curr_patch_idx = 0;
-						patches = calloc(sizeof(kip1_patch_t), 16); // Max 16 patches per set.
+		// If not found, add it as a new entry.
+		if (!_kip_id_find(ext_kip->name, ext_kip->hash, _kip_id_sets_cnt, &pos))
+		{
+			memcpy(&_kip_id_sets[_kip_id_sets_cnt], ext_kip, sizeof(kip1_id_t));
+			_kip_id_index_insert(_kip_id_sets_cnt, pos, _kip_id_sets_cnt);
+			_kip_id_sets_cnt++;
 
-						patchsets[curr_patchset_idx].name = malloc(strlen(pt->name) + 1);
-						strcpy(patchsets[curr_patchset_idx].name, pt->name);
-						patchsets[curr_patchset_idx].patches = patches;
-					}
-				}
+			continue;
+		}
 
-				if (pt->length)
-				{
-					patches[curr_patch_idx].offset = pt->offset;
-					patches[curr_patch_idx].length = pt->length;
+		kip1_id_t *curr_kip = &_kip_id_sets[_kip_id_idx[pos]];
 
-					patches[curr_patch_idx].srcData = malloc(pt->length);
-					patches[curr_patch_idx].dstData = malloc(pt->length);
-					memcpy(patches[curr_patch_idx].srcData, pt->srcData, pt->length);
-					memcpy(patches[curr_patch_idx].dstData, pt->dstData, pt->length);
-				}
-				else
-					patches[curr_patch_idx].srcData = malloc(1); // Empty patches check. Keep everything else as 0.
+		u32 patchsets_cnt = 0;
+		u32 ext_patchsets_cnt = 0;
+		while (curr_kip->patchset[patchsets_cnt].name)
+			patchsets_cnt++;
+		while (ext_kip->patchset[ext_patchsets_cnt].name)
+			ext_patchsets_cnt++;
 
-				curr_patch_idx++;
-			}
-			curr_patchset_idx++;
-			patchsets[curr_patchset_idx].name = NULL;
-			patchsets[curr_patchset_idx].patches = NULL;
-		}
+		kip1_patchset_t *patchsets = (kip1_patchset_t *)calloc(sizeof(kip1_patchset_t), patchsets_cnt + ext_patchsets_cnt + 1);
+		memcpy(patchsets, curr_kip->patchset, patchsets_cnt * sizeof(kip1_patchset_t));
+		memcpy(&patchsets[patchsets_cnt], ext_kip->patchset, ext_patchsets_cnt * sizeof(kip1_patchset_t));
+
+		curr_kip->patchset = patchsets;
 	}
 
 	ext_patches_done = true;
@@ -862,7 +847,7 @@ const pkg2_kernel_id_t *pkg2_identify(u8 *hash)
 	return NULL;
 }
 
-static u32 _pkg2_calc_kip1_size(pkg2_kip1_t *kip1)
+u32 pkg2_calc_kip1_size(pkg2_kip1_t *kip1)
 {
 	u32 size = sizeof(pkg2_kip1_t);
 	for (u32 j = 0; j < KIP1_NUM_SECTIONS; j++)
@@ -924,7 +909,7 @@ bool pkg2_parse_kips(link_t *info, pkg2_hdr_t *pkg2, bool *new_pkg2)
 		pkg2_kip1_t *kip1 = (pkg2_kip1_t *)ptr;
 		pkg2_kip1_info_t *ki = (pkg2_kip1_info_t *)malloc(sizeof(pkg2_kip1_info_t));
 		ki->kip1 = kip1;
-		ki->size = _pkg2_calc_kip1_size(kip1);
+		ki->size = pkg2_calc_kip1_size(kip1);
 		list_append(info, &ki->link);
 		ptr += ki->size;
 DPRINTF(" kip1 %d:%s @ %08X (%08X)\n", i, kip1->name, (u32)kip1, ki->size);
@@ -948,7 +933,7 @@ void pkg2_replace_kip(link_t *info, u64 tid, pkg2_kip1_t *kip1)
 		if (ki->kip1->tid == tid)
 		{
 			ki->kip1 = kip1;
-			ki->size = _pkg2_calc_kip1_size(kip1);
+			ki->size = pkg2_calc_kip1_size(kip1);
 DPRINTF("replaced kip %s (new size %08X)\n", kip1->name, ki->size);
 			return;
 		}
@@ -959,7 +944,7 @@ void pkg2_add_kip(link_t *info, pkg2_kip1_t *kip1)
 {
 	pkg2_kip1_info_t *ki = (pkg2_kip1_info_t *)malloc(sizeof(pkg2_kip1_info_t));
 	ki->kip1 = kip1;
-	ki->size = _pkg2_calc_kip1_size(kip1);
+	ki->size = pkg2_calc_kip1_size(kip1);
 DPRINTF("added kip %s (size %08X)\n", kip1->name, ki->size);
 	list_append(info, &ki->link);
 }
@@ -972,10 +957,10 @@ void pkg2_merge_kip(link_t *info, pkg2_kip1_t *kip1)
 		pkg2_add_kip(info, kip1);
 }
 
-int pkg2_decompress_kip(pkg2_kip1_info_t* ki, u32 sectsToDecomp)
+int pkg2_decompress_kip(pkg2_kip1_info_t* ki, u32 sectsToDecomp, u32 reserveSize)
 {
 	u32 compClearMask = ~sectsToDecomp;
-	if ((ki->kip1->flags & compClearMask) == ki->kip1->flags)
+	if (!reserveSize && (ki->kip1->flags & compClearMask) == ki->kip1->flags)
 		return 0; // Already decompressed, nothing to do.
 
 	pkg2_kip1_t hdr;
@@ -992,7 +977,9 @@ int pkg2_decompress_kip(pkg2_kip1_info_t* ki, u32 sectsToDecomp)
 			newKipSize += hdr.sections[sectIdx].size_comp;
 	}
 
-	pkg2_kip1_t* newKip = malloc(newKipSize);
+	// Reserved space goes before the KIP, so code can be injected in place after patching.
+	u8 *newKipBuf = malloc(newKipSize + reserveSize);
+	pkg2_kip1_t* newKip = (pkg2_kip1_t *)(newKipBuf + reserveSize);
 	unsigned char* dstDataPtr = newKip->data;
 	const unsigned char* srcDataPtr = ki->kip1->data;
 	for (u32 sectIdx = 0; sectIdx < KIP1_NUM_SECTIONS; sectIdx++)
@@ -1018,7 +1005,7 @@ int pkg2_decompress_kip(pkg2_kip1_info_t* ki, u32 sectsToDecomp)
 		{
 			gfx_con.mute = false;
 			gfx_printf("%kERROR decomping sect %d of %s KIP!%k\n", 0xFFFF0000, sectIdx, (char*)hdr.name, 0xFFCCCCCC);
-			free(newKip);
+			free(newKipBuf);
 
 			return 1;
 		}
@@ -1042,67 +1029,51 @@ int pkg2_decompress_kip(pkg2_kip1_info_t* ki, u32 sectsToDecomp)
 	return 0;
 }
 
-static int _kipm_inject(const char *kipm_path, char *target_name, pkg2_kip1_info_t* ki)
+static void _kipm_inject(pkg2_kip1_info_t* ki, u8 *kipm_data, u32 inject_size)
 {
-	if (!strcmp((const char *)ki->kip1->name, target_name))
-	{
-		u32 size = 0;
-		u8 *kipm_data = (u8 *)sd_file_read(kipm_path, &size);
-		if (!kipm_data)
-			return 1;
-
-		u32 inject_size = size - sizeof(ki->kip1->caps);
-		u8 *kip_patched_data = (u8 *)malloc(ki->size + inject_size);
+	// KIP was decompressed after a reserved space of inject size. Move header there.
+	pkg2_kip1_t *fs_kip = (pkg2_kip1_t *)((u8 *)ki->kip1 - inject_size);
+	memmove(fs_kip, ki->kip1, sizeof(pkg2_kip1_t));
+	ki->kip1 = fs_kip;
+	ki->size += inject_size;
 
-		// Copy headers.
-		memcpy(kip_patched_data, ki->kip1, sizeof(pkg2_kip1_t));
+	// Patch caps.
+	memcpy(&ki->kip1->caps, kipm_data, sizeof(ki->kip1->caps));
+	// Copy our .text data. Old data is already in place after it.
+	memcpy(&ki->kip1->data, kipm_data + sizeof(ki->kip1->caps), inject_size);
 
-		pkg2_kip1_t *fs_kip = ki->kip1;
-		ki->kip1 = (pkg2_kip1_t *)kip_patched_data;
-		ki->size = ki->size + inject_size;
+	ki->kip1->sections[0].size_decomp += inject_size;
+	ki->kip1->sections[0].size_comp += inject_size;
+	for (u32 currSectIdx = 1; currSectIdx < KIP1_NUM_SECTIONS - 2; currSectIdx++)
+		ki->kip1->sections[currSectIdx].offset += inject_size;
 
-		// Patch caps.
-		memcpy(&ki->kip1->caps, kipm_data, sizeof(ki->kip1->caps));
-		// Copy our .text data.
-		memcpy(&ki->kip1->data, kipm_data + sizeof(ki->kip1->caps), inject_size);
-
-		u32 new_offset = 0;
-
-		for (u32 currSectIdx = 0; currSectIdx < KIP1_NUM_SECTIONS - 2; currSectIdx++)
-		{
-			if(!currSectIdx) // .text.
-			{
-				memcpy(ki->kip1->data + inject_size, fs_kip->data, fs_kip->sections[0].size_comp);
-				ki->kip1->sections[0].size_decomp += inject_size;
-				ki->kip1->sections[0].size_comp += inject_size;
-			}
-			else // Others.
-			{
-				if (currSectIdx < 3)
-					memcpy(ki->kip1->data + new_offset + inject_size, fs_kip->data + new_offset, fs_kip->sections[currSectIdx].size_comp);
-				ki->kip1->sections[currSectIdx].offset += inject_size;
-			}
-			new_offset += fs_kip->sections[currSectIdx].size_comp;
-		}
-
-		// Patch PMC capabilities for 1.0.0.
-		if (!emu_cfg.fs_ver)
+	// Patch PMC capabilities for 1.0.0.
+	if (!emu_cfg.fs_ver)
+	{
+		for (u32 i = 0; i < 0x20; i++)
 		{
-			for (u32 i = 0; i < 0x20; i++)
+			if (ki->kip1->caps[i] == 0xFFFFFFFF)
 			{
-				if (ki->kip1->caps[i] == 0xFFFFFFFF)
-				{
-					ki->kip1->caps[i] = 0x07000E7F;
-					break;
-				}
+				ki->kip1->caps[i] = 0x07000E7F;
+				break;
 			}
 		}
+	}
+}
 
-		free(kipm_data);
-		return 0;
+static const char *_kipm_inject_abort(pkg2_kip1_info_t* ki, u8 *kipm_data, u32 inject_size, const char *res)
+{
+	// KIP starts after the reserved space. Move it back to the start of its buffer, so it can be freed.
+	if (inject_size)
+	{
+		u8 *kip_buf = (u8 *)ki->kip1 - inject_size;
+		memmove(kip_buf, ki->kip1, ki->size);
+		ki->kip1 = (pkg2_kip1_t *)kip_buf;
 	}
 
-	return 1;
+	free(kipm_data);
+
+	return res;
 }
 
 static bool ext_patches_parsed = false;
@@ -1167,14 +1138,20 @@ const char* pkg2_patch_kips(link_t *info, char* patchNames)
 		DPRINTF("Requested patch: '%s'\n", patches[i]);
 	}
 
+	static const u8 firstHash[8] = {0};
 	u32 shaBuf[32 / sizeof(u32)];
 	LIST_FOREACH_ENTRY(pkg2_kip1_info_t, ki, info, link)
 	{
 		shaBuf[0] = 0; // sha256 for this kip not yet calculated.
-		for (u32 currKipIdx = 0; currKipIdx < _kip_id_sets_cnt; currKipIdx++)
+
+		// Iterate over the sorted ids with the same name.
+		u32 idxPos;
+		_kip_id_find((const char*)ki->kip1->name, firstHash, _kip_id_sets_cnt, &idxPos);
+		for (; idxPos < _kip_id_sets_cnt; idxPos++)
 		{
+			u32 currKipIdx = _kip_id_idx[idxPos];
 			if (strncmp((const char*)ki->kip1->name, _kip_id_sets[currKipIdx].name, sizeof(ki->kip1->name)) != 0)
-				continue;
+				break;
 
 			u32 bitsAffected = 0;
 			kip1_patchset_t* currPatchset = _kip_id_sets[currKipIdx].patchset;
@@ -1206,6 +1183,7 @@ const char* pkg2_patch_kips(link_t *info, char* patchNames)
 				continue;
 
 			// Find out which sections are affected by the enabled patches, to know which to decompress.
+			bool emummcAffected = false;
 			bitsAffected = 0;
 			currPatchset = _kip_id_sets[currKipIdx].patchset;
 			while (currPatchset != NULL && currPatchset->name != NULL)
@@ -1218,7 +1196,10 @@ const char* pkg2_patch_kips(link_t *info, char* patchNames)
 							continue;
 
 						if (!strcmp(currPatchset->name, "emummc"))
+						{
+							emummcAffected = true;
 							bitsAffected |= 1u << GET_KIP_PATCH_SECTION(currPatchset->patches->offset);
+						}
 
 						for (const kip1_patch_t* currPatch=currPatchset->patches; currPatch != NULL && (currPatch->length != 0); currPatch++)
 							bitsAffected |= 1u << GET_KIP_PATCH_SECTION(currPatch->offset);
@@ -1227,12 +1208,29 @@ const char* pkg2_patch_kips(link_t *info, char* patchNames)
 				currPatchset++;
 			}
 
+			// Load emuMMC module, so its code can be injected without another KIP copy.
+			u8 *kipmData = NULL;
+			u32 kipmInjectSize = 0;
+			if (emummcAffected && !strncmp(_kip_id_sets[currKipIdx].name, "FS", 2))
+			{
+				u32 kipmSize = 0;
+				if (!strcmp((const char *)ki->kip1->name, "FS"))
+					kipmData = (u8 *)sd_file_read("/bootloader/sys/emummc.kipm", &kipmSize);
+				if (!kipmData)
+					return "emummc";
+
+				kipmInjectSize = kipmSize - sizeof(ki->kip1->caps);
+			}
+
 			// Got patches to apply to this kip, have to decompress it.
 #ifdef DEBUG_PRINTING
 			u32 preDecompTime = get_tmr_us();
 #endif
-			if (pkg2_decompress_kip(ki, bitsAffected))
+			if (pkg2_decompress_kip(ki, bitsAffected, kipmInjectSize))
+			{
+				free(kipmData);
 				return (const char*)ki->kip1->name; // Failed to decompress.
+			}
 
 #ifdef DEBUG_PRINTING
 			u32 postDecompTime = get_tmr_us();
@@ -1284,7 +1282,8 @@ const char* pkg2_patch_kips(link_t *info, char* patchNames)
 								{
 									gfx_con.mute = false;
 									gfx_printf("%kPatch is empty!%k\n", 0xFFFF0000, 0xFFCCCCCC);
-									return currPatchset->name; // MUST stop here as it's not probably intended.
+									// MUST stop here as it's not probably intended.
+									return _kipm_inject_abort(ki, kipmData, kipmInjectSize, currPatchset->name);
 								}
 
 								u32 currOffset = GET_KIP_PATCH_OFFSET(currPatch->offset);
@@ -1294,7 +1293,8 @@ const char* pkg2_patch_kips(link_t *info, char* patchNames)
 								{
 									gfx_con.mute = false;
 									gfx_printf("%kPatch data mismatch at 0x%x!%k\n", 0xFFFF0000, currOffset, 0xFFCCCCCC);
-									return currPatchset->name; // MUST stop here as kip is likely corrupt.
+									// MUST stop here as kip is likely corrupt.
+									return _kipm_inject_abort(ki, kipmData, kipmInjectSize, currPatchset->name);
 								}
 								else
 								{
@@ -1321,8 +1321,11 @@ const char* pkg2_patch_kips(link_t *info, char* patchNames)
 					emu_cfg.fs_ver -= 2;
 
 				gfx_printf("Injecting emuMMC. FS ver: %d\n", emu_cfg.fs_ver);
-				if (_kipm_inject("/bootloader/sys/emummc.kipm", "FS", ki))
-					return "emummc";
+				if (!kipmData)
+					return _kipm_inject_abort(ki, kipmData, kipmInjectSize, "emummc");
+
+				_kipm_inject(ki, kipmData, kipmInjectSize);
+				free(kipmData);
 			}
 		}
 	}
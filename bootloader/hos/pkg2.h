@@ -146,6 +146,7 @@ typedef struct _kip1_id_t
 	kip1_patchset_t* patchset;
 } kip1_id_t;
 
+u32  pkg2_calc_kip1_size(pkg2_kip1_t *kip1);
 void pkg2_get_newkern_info(u8 *kern_data);
 bool pkg2_parse_kips(link_t *info, pkg2_hdr_t *pkg2, bool *new_pkg2);
 int  pkg2_has_kip(link_t *info, u64 tid);
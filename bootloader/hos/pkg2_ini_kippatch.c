@@ -4,6 +4,7 @@
 #include "pkg2_ini_kippatch.h"
 #include <libs/fatfs/ff.h>
 #include <mem/heap.h>
+#include <storage/nx_sd.h>
 
 #define KPS(x) ((u32)(x) << 29)
 
@@ -154,3 +155,229 @@ int ini_patch_parse(link_t *dst, char *ini_path)
 
 	return 1;
 }
+
+static u32 _ini_patch_cache_str(u8 *buf, u32 *pos, const char *str)
+{
+	u32 off = *pos;
+	u32 len = strlen(str) + 1;
+
+	memcpy(buf + off, str, len);
+	*pos += ALIGN(len, 4);
+
+	return off;
+}
+
+static u32 _ini_patch_cache_sets_count(ini_kip_sec_t *ksec)
+{
+	u32 sets = 0;
+	char *name = NULL;
+
+	LIST_FOREACH_ENTRY(ini_patchset_t, pt, &ksec->pts, link)
+	{
+		if (!name || strcmp(pt->name, name))
+			sets++;
+		name = pt->name;
+	}
+
+	return sets;
+}
+
+static u32 _ini_patch_cache_patches_count(ini_kip_sec_t *ksec, ini_patchset_t *pt)
+{
+	u32 patches = 0;
+	char *name = pt->name;
+
+	for (link_t *l = &pt->link; l != &ksec->pts; l = l->next, patches++)
+		if (strcmp(CONTAINER_OF(l, ini_patchset_t, link)->name, name))
+			break;
+
+	return patches;
+}
+
+static u8 *_ini_patch_cache_compile(link_t *ini_kip_sections)
+{
+	// Get an upper bound of the compiled size.
+	u32 ids_cnt = 0;
+	u32 size = sizeof(kip_patch_cache_hdr_t);
+	LIST_FOREACH_ENTRY(ini_kip_sec_t, ksec, ini_kip_sections, link)
+	{
+		ids_cnt++;
+		size += sizeof(kip1_id_t) + ALIGN(strlen(ksec->name) + 1, 4) + sizeof(kip1_patchset_t);
+		LIST_FOREACH_ENTRY(ini_patchset_t, pt, &ksec->pts, link)
+			size += sizeof(kip1_patchset_t) + sizeof(kip1_patch_t) * 2 + ALIGN(strlen(pt->name) + 1, 4) + ALIGN(pt->length * 2 + 1, 4);
+	}
+
+	u8 *buf = (u8 *)calloc(size, 1);
+	kip_patch_cache_hdr_t *hdr = (kip_patch_cache_hdr_t *)buf;
+	kip1_id_t *id = (kip1_id_t *)(buf + sizeof(kip_patch_cache_hdr_t));
+	u32 pos = sizeof(kip_patch_cache_hdr_t) + ids_cnt * sizeof(kip1_id_t);
+
+	// Pointers are stored as offsets from the start of the buffer.
+	LIST_FOREACH_ENTRY(ini_kip_sec_t, ksec, ini_kip_sections, link)
+	{
+		id->name = (char *)_ini_patch_cache_str(buf, &pos, ksec->name);
+		memcpy(id->hash, ksec->hash, sizeof(id->hash));
+
+		// Patchsets are terminated by a NULL name.
+		kip1_patchset_t *set = (kip1_patchset_t *)(buf + pos);
+		id->patchset = (kip1_patchset_t *)pos;
+		pos += (_ini_patch_cache_sets_count(ksec) + 1) * sizeof(kip1_patchset_t);
+		id++;
+
+		kip1_patch_t *patch = NULL;
+		char *name = NULL;
+		LIST_FOREACH_ENTRY(ini_patchset_t, pt, &ksec->pts, link)
+		{
+			// Create a new patchset. Patches are terminated by a NULL source.
+			if (!name || strcmp(pt->name, name))
+			{
+				name = pt->name;
+				set->name = (char *)_ini_patch_cache_str(buf, &pos, pt->name);
+				set->patches = (kip1_patch_t *)pos;
+				patch = (kip1_patch_t *)(buf + pos);
+				pos += (_ini_patch_cache_patches_count(ksec, pt) + 1) * sizeof(kip1_patch_t);
+				set++;
+			}
+
+			patch->srcData = (char *)pos;
+			if (pt->length)
+			{
+				patch->offset = pt->offset;
+				patch->length = pt->length;
+				patch->dstData = (char *)(pos + pt->length);
+
+				memcpy(buf + pos, pt->srcData, pt->length);
+				memcpy(buf + pos + pt->length, pt->dstData, pt->length);
+				pos += ALIGN(pt->length * 2, 4);
+			}
+			else
+				pos += 4; // Empty patches check. Keep everything else as 0.
+
+			patch++;
+		}
+	}
+
+	hdr->magic = KIP_PATCH_CACHE_MAGIC;
+	hdr->version = KIP_PATCH_CACHE_VERSION;
+	hdr->size = pos;
+	hdr->ids_cnt = ids_cnt;
+
+	return buf;
+}
+
+static bool _ini_patch_cache_reloc_ptr(u8 *buf, u32 size, void *ptr, u32 len, u32 align)
+{
+	u32 *off = (u32 *)ptr;
+
+	// Pointed data must fit and be aligned. 0 is NULL.
+	if (*off > size || len > size - *off || (*off & (align - 1)))
+		return false;
+
+	if (*off)
+		*off += (u32)buf;
+
+	return true;
+}
+
+static bool _ini_patch_cache_reloc_str(u8 *buf, u32 size, void *ptr)
+{
+	u32 *off = (u32 *)ptr;
+
+	// String must be terminated inside the cache.
+	if (!*off || *off >= size || !memchr(buf + *off, 0, size - *off))
+		return false;
+
+	*off += (u32)buf;
+
+	return true;
+}
+
+static bool _ini_patch_cache_reloc(u8 *buf)
+{
+	kip_patch_cache_hdr_t *hdr = (kip_patch_cache_hdr_t *)buf;
+	kip1_id_t *ids = (kip1_id_t *)(buf + sizeof(kip_patch_cache_hdr_t));
+	u32 size = hdr->size;
+
+	if (hdr->ids_cnt > (size - sizeof(kip_patch_cache_hdr_t)) / sizeof(kip1_id_t))
+		return false;
+
+	// Convert offsets back to pointers. Every entry is bounds checked before it's read.
+	for (u32 i = 0; i < hdr->ids_cnt; i++)
+	{
+		if (!_ini_patch_cache_reloc_str(buf, size, &ids[i].name) ||
+			!_ini_patch_cache_reloc_ptr(buf, size, &ids[i].patchset, sizeof(kip1_patchset_t), 4) || !ids[i].patchset)
+			return false;
+
+		for (kip1_patchset_t *set = ids[i].patchset; ; set++)
+		{
+			if ((u8 *)&set[1] > buf + size)
+				return false;
+
+			if (!set->name)
+				break;
+
+			if (!_ini_patch_cache_reloc_str(buf, size, &set->name) ||
+				!_ini_patch_cache_reloc_ptr(buf, size, &set->patches, sizeof(kip1_patch_t), 4) || !set->patches)
+				return false;
+
+			for (kip1_patch_t *patch = set->patches; ; patch++)
+			{
+				if ((u8 *)&patch[1] > buf + size)
+					return false;
+
+				if (!patch->srcData)
+					break;
+
+				if (!_ini_patch_cache_reloc_ptr(buf, size, &patch->srcData, patch->length, 1) ||
+					!_ini_patch_cache_reloc_ptr(buf, size, &patch->dstData, patch->length, 1))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+kip1_id_t *ini_patch_cache_load(char *ini_path, char *cache_path, u32 *ids_cnt)
+{
+	FILINFO fno;
+
+	*ids_cnt = 0;
+	if (f_stat(ini_path, &fno))
+		return NULL;
+
+	// Use the compiled patches if the ini is unchanged.
+	u32 size = 0;
+	u8 *buf = (u8 *)sd_file_read(cache_path, &size);
+	kip_patch_cache_hdr_t *hdr = (kip_patch_cache_hdr_t *)buf;
+	if (buf && (size < sizeof(kip_patch_cache_hdr_t) ||
+		hdr->magic != KIP_PATCH_CACHE_MAGIC || hdr->version != KIP_PATCH_CACHE_VERSION ||
+		hdr->ini_date != ((fno.fdate << 16) | fno.ftime) || hdr->ini_size != fno.fsize ||
+		hdr->size != size || !_ini_patch_cache_reloc(buf)))
+	{
+		free(buf);
+		buf = NULL;
+	}
+
+	// Otherwise parse the ini and compile it.
+	if (!buf)
+	{
+		LIST_INIT(ini_kip_sections);
+		if (!ini_patch_parse(&ini_kip_sections, ini_path))
+			return NULL;
+
+		buf = _ini_patch_cache_compile(&ini_kip_sections);
+		hdr = (kip_patch_cache_hdr_t *)buf;
+		hdr->ini_date = (fno.fdate << 16) | fno.ftime;
+		hdr->ini_size = fno.fsize;
+
+		f_mkdir("bootloader/cache");
+		sd_save_to_file(buf, hdr->size, cache_path);
+
+		_ini_patch_cache_reloc(buf);
+	}
+
+	*ids_cnt = hdr->ids_cnt;
+
+	return (kip1_id_t *)(buf + sizeof(kip_patch_cache_hdr_t));
+}
@@ -20,6 +20,21 @@
 #include <utils/types.h>
 #include <utils/list.h>
 
+#include "pkg2.h"
+
+#define KIP_PATCH_CACHE_MAGIC   0x3043504B // "KPC0".
+#define KIP_PATCH_CACHE_VERSION 1
+
+typedef struct _kip_patch_cache_hdr_t
+{
+	u32 magic;
+	u32 version;
+	u32 ini_date; // FAT date and time.
+	u32 ini_size;
+	u32 size;
+	u32 ids_cnt;
+} kip_patch_cache_hdr_t;
+
 typedef struct _ini_patchset_t
 {
 	char *name;
@@ -39,5 +54,6 @@ typedef struct _ini_kip_sec_t
 } ini_kip_sec_t;
 
 int ini_patch_parse(link_t *dst, char *ini_path);
+kip1_id_t *ini_patch_cache_load(char *ini_path, char *cache_path, u32 *ids_cnt);
 
 #endif
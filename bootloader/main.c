@@ -52,6 +52,7 @@
 #include <storage/nx_sd.h>
 #include <storage/sdmmc.h>
 #include <utils/btn.h>
+#include <utils/btrace.h>
 #include <utils/dirlist.h>
 #include <utils/list.h>
 #include <utils/util.h>
@@ -675,6 +676,7 @@ out:
 
 void nyx_load_run()
 {
+	btrace_begin("nyx_load");
 	sd_mount();
 
 	u8 *nyx = sd_file_read("bootloader/sys/nyx.bin", NULL);
@@ -682,6 +684,7 @@ void nyx_load_run()
 		return;
 
 	sd_end();
+	btrace_end("nyx_load");
 
 	// Show loading logo.
 	gfx_clear_grey(0x1B);
@@ -754,24 +757,57 @@ void nyx_load_run()
 	(*nyx_ptr)();
 }
 
+enum
+{
+	KEY_AUTOBOOT = 1,
+	KEY_AUTOBOOT_LIST,
+	KEY_BOOTWAIT,
+	KEY_BACKLIGHT,
+	KEY_AUTOHOSOFF,
+	KEY_AUTONOGC,
+	KEY_UPDATER2P,
+	KEY_BOOTPROTECT,
+	KEY_ID,
+	KEY_LOGOPATH,
+	KEY_EMUMMC_FORCE_DISABLE,
+	KEY_EMUPATH
+};
+
+// Must match the key enum order. Resolved once when the config cache is built.
+static const char * const ini_keys[] = {
+	"autoboot",
+	"autoboot_list",
+	"bootwait",
+	"backlight",
+	"autohosoff",
+	"autonogc",
+	"updater2p",
+	"bootprotect",
+	"id",
+	"logopath",
+	"emummc_force_disable",
+	"emupath",
+	NULL
+};
+
 static ini_sec_t *get_ini_sec_from_id(ini_sec_t *ini_sec, char **bootlogoCustomEntry, char **emummc_path)
 {
 	ini_sec_t *cfg_sec = NULL;
 
 	LIST_FOREACH_ENTRY(ini_kv_t, kv, &ini_sec->kvs, link)
 	{
-		if (!strcmp("id", kv->key))
+		if (kv->id == KEY_ID)
 		{
 			if (b_cfg.id[0] && kv->val[0] && !strcmp(b_cfg.id, kv->val))
 				cfg_sec = ini_sec;
 			else
 				break;
 		}
-		if (!strcmp("logopath", kv->key))
+		if (kv->id == KEY_LOGOPATH)
 			*bootlogoCustomEntry = kv->val;
-		if (!strcmp("emummc_force_disable", kv->key))
+		if (kv->id == KEY_EMUMMC_FORCE_DISABLE)
 			h_cfg.emummc_force_disable = atoi(kv->val);
-		if (!strcmp("emupath", kv->key))
+		if (kv->id == KEY_EMUPATH)
 			*emummc_path = kv->val;
 	}
 	if (!cfg_sec)
@@ -784,6 +820,25 @@ static ini_sec_t *get_ini_sec_from_id(ini_sec_t *ini_sec, char **bootlogoCustomE
 	return cfg_sec;
 }
 
+static void _get_ini_sec_boot_cfg(ini_sec_t *cfg_sec, char **bootlogoCustomEntry, char **emummc_path)
+{
+	LIST_FOREACH_ENTRY(ini_kv_t, kv, &cfg_sec->kvs, link)
+	{
+		switch (kv->id)
+		{
+		case KEY_LOGOPATH:
+			*bootlogoCustomEntry = kv->val;
+			break;
+		case KEY_EMUMMC_FORCE_DISABLE:
+			h_cfg.emummc_force_disable = atoi(kv->val);
+			break;
+		case KEY_EMUPATH:
+			*emummc_path = kv->val;
+			break;
+		}
+	}
+}
+
 static void _bootloader_corruption_protect()
 {
 	FILINFO fno;
@@ -842,79 +897,81 @@ static void _auto_launch_firmware()
 		if (f_stat("bootloader/hekate_ipl.ini", NULL))
 			create_config_entry();
 
-		if (ini_parse(&ini_sections, "bootloader/hekate_ipl.ini", false))
+		ini_index_t ini_idx;
+		if (ini_parse_cached(&ini_sections, "bootloader/hekate_ipl.ini", false, "bootloader/cache/hekate_ipl.bin", ini_keys, &ini_idx))
 		{
 			u32 configEntry = 0;
-			u32 boot_entry_id = 0;
 
-			// Load configuration.
-			LIST_FOREACH_ENTRY(ini_sec_t, ini_sec, &ini_sections, link)
+			// Load configuration. Later [config] sections override earlier ones.
+			for (u32 i = ini_idx.config_pos; i < ini_idx.choices_cnt; i++)
 			{
-				// Skip other ini entries for autoboot.
-				if (ini_sec->type == INI_CHOICE)
+				if (strcmp(ini_idx.choices[i]->name, "config"))
+					continue;
+
+				configEntry = 1;
+				LIST_FOREACH_ENTRY(ini_kv_t, kv, &ini_idx.choices[i]->kvs, link)
 				{
-					if (!strcmp(ini_sec->name, "config"))
+					switch (kv->id)
 					{
-						configEntry = 1;
-						LIST_FOREACH_ENTRY(ini_kv_t, kv, &ini_sec->kvs, link)
-						{
-							if (!strcmp("autoboot", kv->key))
-								h_cfg.autoboot = atoi(kv->val);
-							else if (!strcmp("autoboot_list", kv->key))
-								h_cfg.autoboot_list = atoi(kv->val);
-							else if (!strcmp("bootwait", kv->key))
-								h_cfg.bootwait = atoi(kv->val);
-							else if (!strcmp("backlight", kv->key))
-								h_cfg.backlight = atoi(kv->val);
-							else if (!strcmp("autohosoff", kv->key))
-								h_cfg.autohosoff = atoi(kv->val);
-							else if (!strcmp("autonogc", kv->key))
-								h_cfg.autonogc = atoi(kv->val);
-							else if (!strcmp("updater2p", kv->key))
-								h_cfg.updater2p = atoi(kv->val);
-							else if (!strcmp("bootprotect", kv->key))
-								h_cfg.bootprotect = atoi(kv->val);
-						}
-						boot_entry_id++;
-
-						// Override autoboot, otherwise save it for a possbile sept run.
-						if (b_cfg.boot_cfg & BOOT_CFG_AUTOBOOT_EN)
-						{
-							h_cfg.autoboot = b_cfg.autoboot;
-							h_cfg.autoboot_list = b_cfg.autoboot_list;
-						}
-						else
-						{
-							b_cfg.autoboot = h_cfg.autoboot;
-							b_cfg.autoboot_list = h_cfg.autoboot_list;
-						}
-
-						// Apply bootloader protection against corruption.
-						_bootloader_corruption_protect();
-
-						continue;
+					case KEY_AUTOBOOT:
+						h_cfg.autoboot = atoi(kv->val);
+						break;
+					case KEY_AUTOBOOT_LIST:
+						h_cfg.autoboot_list = atoi(kv->val);
+						break;
+					case KEY_BOOTWAIT:
+						h_cfg.bootwait = atoi(kv->val);
+						break;
+					case KEY_BACKLIGHT:
+						h_cfg.backlight = atoi(kv->val);
+						break;
+					case KEY_AUTOHOSOFF:
+						h_cfg.autohosoff = atoi(kv->val);
+						break;
+					case KEY_AUTONOGC:
+						h_cfg.autonogc = atoi(kv->val);
+						break;
+					case KEY_UPDATER2P:
+						h_cfg.updater2p = atoi(kv->val);
+						break;
+					case KEY_BOOTPROTECT:
+						h_cfg.bootprotect = atoi(kv->val);
+						break;
 					}
+				}
+			}
 
-					if (boot_from_id)
-						cfg_sec = get_ini_sec_from_id(ini_sec, &bootlogoCustomEntry, &emummc_path);
-					else if (h_cfg.autoboot == boot_entry_id && configEntry)
-					{
-						cfg_sec = ini_sec;
-						LIST_FOREACH_ENTRY(ini_kv_t, kv, &cfg_sec->kvs, link)
-						{
-							if (!strcmp("logopath", kv->key))
-								bootlogoCustomEntry = kv->val;
-							else if (!strcmp("emummc_force_disable", kv->key))
-								h_cfg.emummc_force_disable = atoi(kv->val);
-							else if (!strcmp("emupath", kv->key))
-								emummc_path = kv->val;
-						}
-					}
-					if (cfg_sec)
-						break;
-					boot_entry_id++;
+			if (configEntry)
+			{
+				// Override autoboot, otherwise save it for a possbile sept run.
+				if (b_cfg.boot_cfg & BOOT_CFG_AUTOBOOT_EN)
+				{
+					h_cfg.autoboot = b_cfg.autoboot;
+					h_cfg.autoboot_list = b_cfg.autoboot_list;
 				}
+				else
+				{
+					b_cfg.autoboot = h_cfg.autoboot;
+					b_cfg.autoboot_list = h_cfg.autoboot_list;
+				}
+
+				// Apply bootloader protection against corruption.
+				_bootloader_corruption_protect();
+			}
+
+			if (boot_from_id)
+			{
+				for (u32 i = 0; i < ini_idx.entries_cnt && !cfg_sec; i++)
+					cfg_sec = get_ini_sec_from_id(ini_idx.entries[i], &bootlogoCustomEntry, &emummc_path);
+			}
+			else if (configEntry && h_cfg.autoboot > ini_idx.config_pos && h_cfg.autoboot < ini_idx.choices_cnt &&
+				strcmp(ini_idx.choices[h_cfg.autoboot]->name, "config"))
+			{
+				// Entries before [config] can't autoboot.
+				cfg_sec = ini_idx.choices[h_cfg.autoboot];
+				_get_ini_sec_boot_cfg(cfg_sec, &bootlogoCustomEntry, &emummc_path);
 			}
+			ini_free(&ini_idx);
 
 			if (h_cfg.autohosoff && !(b_cfg.boot_cfg & BOOT_CFG_AUTOBOOT_EN))
 				check_power_off_from_hos();
@@ -925,42 +982,23 @@ static void _auto_launch_firmware()
 					goto skip_list;
 
 				cfg_sec = NULL;
-				boot_entry_id = 1;
 				bootlogoCustomEntry = NULL;
 
-				if (ini_parse(&ini_list_sections, "bootloader/ini", true))
+				if (ini_parse_cached(&ini_list_sections, "bootloader/ini", true, "bootloader/cache/ini.bin", ini_keys, &ini_idx))
 				{
-					LIST_FOREACH_ENTRY(ini_sec_t, ini_sec_list, &ini_list_sections, link)
+					if (boot_from_id)
 					{
-						if (ini_sec_list->type == INI_CHOICE)
-						{
-							if (!strcmp(ini_sec_list->name, "config"))
-								continue;
-
-							if (boot_from_id)
-								cfg_sec = get_ini_sec_from_id(ini_sec_list, &bootlogoCustomEntry, &emummc_path);
-							else if (h_cfg.autoboot == boot_entry_id)
-							{
-								h_cfg.emummc_force_disable = false;
-								cfg_sec = ini_sec_list;
-								LIST_FOREACH_ENTRY(ini_kv_t, kv, &cfg_sec->kvs, link)
-								{
-									if (!strcmp("logopath", kv->key))
-										bootlogoCustomEntry = kv->val;
-									else if (!strcmp("emummc_force_disable", kv->key))
-										h_cfg.emummc_force_disable = atoi(kv->val);
-									else if (!strcmp("emupath", kv->key))
-										emummc_path = kv->val;
-								}
-							}
-							if (cfg_sec)
-								break;
-							boot_entry_id++;
-						}
+						for (u32 i = 0; i < ini_idx.entries_cnt && !cfg_sec; i++)
+							cfg_sec = get_ini_sec_from_id(ini_idx.entries[i], &bootlogoCustomEntry, &emummc_path);
 					}
-
+					else if (h_cfg.autoboot && h_cfg.autoboot <= ini_idx.entries_cnt)
+					{
+						h_cfg.emummc_force_disable = false;
+						cfg_sec = ini_idx.entries[h_cfg.autoboot - 1];
+						_get_ini_sec_boot_cfg(cfg_sec, &bootlogoCustomEntry, &emummc_path);
+					}
+					ini_free(&ini_idx);
 				}
-
 			}
 skip_list:
 			// Add missing configuration entry.
@@ -1523,6 +1561,9 @@ void ipl_main()
 	// Tegra/Horizon configuration goes to 0x80000000+, package2 goes to 0xA9800000, we place our heap in between.
 	heap_init(IPL_HEAP_START);
 
+	// Initialize boot tracer. Ring is kept in Nyx storage so Nyx can show it.
+	btrace_init((btrace_t *)&nyx_str->info.trace);
+
 #ifdef DEBUG_UART_PORT
 	uart_send(DEBUG_UART_PORT, (u8 *)"hekate: Hello!\r\n", 16);
 	uart_wait_idle(DEBUG_UART_PORT, UART_TX_IDLE);
@@ -1535,7 +1576,9 @@ void ipl_main()
 	set_default_configuration();
 
 	// Mount SD Card.
+	btrace_begin("sd_mount");
 	h_cfg.errors |= !sd_mount() ? ERR_SD_BOOT_EN : 0;
+	btrace_end("sd_mount");
 
 	// Save sdram lp0 config.
 	void *sdram_params =
@@ -1544,9 +1587,12 @@ void ipl_main()
 		h_cfg.errors |= ERR_LIBSYS_LP0;
 
 	// Train DRAM and switch to max frequency.
+	btrace_begin("minerva");
 	if (minerva_init()) //!TODO: Add Tegra210B01 support to minerva.
 		h_cfg.errors |= ERR_LIBSYS_MTC;
+	btrace_end("minerva");
 
+	btrace_begin("display");
 	display_init();
 
 	u32 *fb = display_init_framebuffer_pitch();
@@ -1556,6 +1602,7 @@ void ipl_main()
 
 	display_backlight_pwm_init();
 	//display_backlight_brightness(h_cfg.backlight, 1000);
+	btrace_end("display");
 
 	// Overclock BPMP.
 	bpmp_clk_rate_set(BPMP_CLK_DEFAULT_BOOST);
@@ -29,11 +29,39 @@
 #include <utils/list.h>
 #include <utils/types.h>
 
+#define EMUMMC_FILE_MAX_PARTS 64
+#define EMUMMC_FILE_MAX_FILES (EMUMMC_FILE_MAX_PARTS + 2) // GPP parts + BOOT0/BOOT1.
+#define EMUMMC_FILE_CLTBL_SZ  0x100 // Link map entries. Enough for 127 fragments.
+
+typedef struct _emummc_file_t
+{
+	FIL   fp;
+	DWORD cltbl[EMUMMC_FILE_CLTBL_SZ];
+} emummc_file_t;
+
 extern hekate_config h_cfg;
 emummc_cfg_t emu_cfg = { 0 };
 
+static emummc_file_t *emu_files[EMUMMC_FILE_MAX_FILES] = { NULL };
+
+static void _emummc_file_close_all()
+{
+	for (u32 i = 0; i < EMUMMC_FILE_MAX_FILES; i++)
+	{
+		if (emu_files[i])
+		{
+			// Fails validation and does nothing if SD was remounted.
+			f_close(&emu_files[i]->fp);
+			free(emu_files[i]);
+			emu_files[i] = NULL;
+		}
+	}
+}
+
 void emummc_load_cfg()
 {
+	_emummc_file_close_all();
+
 	emu_cfg.enabled = 0;
 	emu_cfg.path = NULL;
 	emu_cfg.sector = 0;
@@ -83,6 +111,8 @@ bool emummc_set_path(char *path)
 	FIL fp;
 	bool found = false;
 
+	_emummc_file_close_all();
+
 	strcpy(emu_cfg.emummc_file_based_path, path);
 	strcat(emu_cfg.emummc_file_based_path, "/raw_based");
 
@@ -136,6 +166,8 @@ int emummc_storage_init_mmc()
 	FILINFO fno;
 	emu_cfg.active_part = 0;
 
+	_emummc_file_close_all();
+
 	// Always init eMMC even when in emuMMC. eMMC is needed from the emuMMC driver anyway.
 	if (!sdmmc_storage_init_mmc(&emmc_storage, &emmc_sdmmc, SDMMC_BUS_WIDTH_8, SDHCI_TIMING_MMC_HS400))
 		return 2;
@@ -175,6 +207,8 @@ out:
 
 int emummc_storage_end()
 {
+	_emummc_file_close_all();
+
 	if (!emu_cfg.enabled || h_cfg.emummc_force_disable)
 		sdmmc_storage_end(&emmc_storage);
 	else
@@ -183,9 +217,85 @@ int emummc_storage_end()
 	return 1;
 }
 
+static FIL *_emummc_file_get(u32 file_idx)
+{
+	emummc_file_t *file = emu_files[file_idx];
+
+	if (file)
+	{
+		// Reuse the open handle if it still belongs to the current SD mount.
+		FATFS *fs = file->fp.obj.fs;
+		if (fs && fs->fs_type && file->fp.obj.id == fs->id)
+			return &file->fp;
+	}
+	else
+	{
+		file = (emummc_file_t *)malloc(sizeof(emummc_file_t));
+		if (!file)
+		{
+			// Out of memory. Release all open parts so they can be reopened on demand.
+			_emummc_file_close_all();
+
+			return NULL;
+		}
+		emu_files[file_idx] = file;
+	}
+
+	if (!emu_cfg.active_part)
+	{
+		if (file_idx >= 10)
+			itoa(file_idx, emu_cfg.emummc_file_based_path + strlen(emu_cfg.emummc_file_based_path) - 2, 10);
+		else
+		{
+			emu_cfg.emummc_file_based_path[strlen(emu_cfg.emummc_file_based_path) - 2] = '0';
+			itoa(file_idx, emu_cfg.emummc_file_based_path + strlen(emu_cfg.emummc_file_based_path) - 1, 10);
+		}
+	}
+
+	if (f_open(&file->fp, emu_cfg.emummc_file_based_path, FA_READ | FA_WRITE))
+	{
+		free(file);
+		emu_files[file_idx] = NULL;
+
+		return NULL;
+	}
+
+	// Create the cluster link map once, so seeks and reads don't follow the FAT chain.
+	file->cltbl[0] = EMUMMC_FILE_CLTBL_SZ;
+	file->fp.cltbl = file->cltbl;
+	if (f_lseek(&file->fp, CREATE_LINKMAP))
+		file->fp.cltbl = NULL; // Too fragmented. Fallback to FAT chain.
+
+	return &file->fp;
+}
+
+static FIL *_emummc_file_seek(u32 sector)
+{
+	u32 file_idx;
+
+	if (!emu_cfg.active_part)
+	{
+		file_idx = sector / emu_cfg.file_based_part_size;
+		sector = sector % emu_cfg.file_based_part_size;
+		if (file_idx >= EMUMMC_FILE_MAX_PARTS)
+			return NULL;
+	}
+	else
+		file_idx = EMUMMC_FILE_MAX_PARTS + emu_cfg.active_part - 1;
+
+	FIL *fp = _emummc_file_get(file_idx);
+	if (!fp)
+		return NULL;
+
+	if (f_lseek(fp, (u64)sector << 9))
+		return NULL;
+
+	return fp;
+}
+
 int emummc_storage_read(u32 sector, u32 num_sectors, void *buf)
 {
-	FIL fp;
+	FIL *fp;
 	if (!emu_cfg.enabled || h_cfg.emummc_force_disable)
 		return sdmmc_storage_read(&emmc_storage, sector, num_sectors, buf);
 	else if (emu_cfg.sector)
@@ -196,32 +306,19 @@ int emummc_storage_read(u32 sector, u32 num_sectors, void *buf)
 	}
 	else
 	{
-		if (!emu_cfg.active_part)
-		{
-			u32 file_part = sector / emu_cfg.file_based_part_size;
-			sector = sector % emu_cfg.file_based_part_size;
-			if (file_part >= 10)
-				itoa(file_part, emu_cfg.emummc_file_based_path + strlen(emu_cfg.emummc_file_based_path) - 2, 10);
-			else
-			{
-				emu_cfg.emummc_file_based_path[strlen(emu_cfg.emummc_file_based_path) - 2] = '0';
-				itoa(file_part, emu_cfg.emummc_file_based_path + strlen(emu_cfg.emummc_file_based_path) - 1, 10);
-			}
-		}
-		if (f_open(&fp, emu_cfg.emummc_file_based_path, FA_READ))
+		fp = _emummc_file_seek(sector);
+		if (!fp)
 		{
 			EPRINTF("Failed to open emuMMC image.");
 			return 0;
 		}
-		f_lseek(&fp, (u64)sector << 9);
-		if (f_read(&fp, buf, (u64)num_sectors << 9, NULL))
+
+		if (f_read(fp, buf, (u64)num_sectors << 9, NULL))
 		{
 			EPRINTF("Failed to read emuMMC image.");
-			f_close(&fp);
 			return 0;
 		}
 
-		f_close(&fp);
 		return 1;
 	}
 
@@ -230,7 +327,7 @@ int emummc_storage_read(u32 sector, u32 num_sectors, void *buf)
 
 int emummc_storage_write(u32 sector, u32 num_sectors, void *buf)
 {
-	FIL fp;
+	FIL *fp;
 	if (!emu_cfg.enabled || h_cfg.emummc_force_disable)
 		return sdmmc_storage_write(&emmc_storage, sector, num_sectors, buf);
 	else if (emu_cfg.sector)
@@ -241,30 +338,17 @@ int emummc_storage_write(u32 sector, u32 num_sectors, void *buf)
 	}
 	else
 	{
-		if (!emu_cfg.active_part)
-		{
-			u32 file_part = sector / emu_cfg.file_based_part_size;
-			sector = sector % emu_cfg.file_based_part_size;
-			if (file_part >= 10)
-				itoa(file_part, emu_cfg.emummc_file_based_path + strlen(emu_cfg.emummc_file_based_path) - 2, 10);
-			else
-			{
-				emu_cfg.emummc_file_based_path[strlen(emu_cfg.emummc_file_based_path) - 2] = '0';
-				itoa(file_part, emu_cfg.emummc_file_based_path + strlen(emu_cfg.emummc_file_based_path) - 1, 10);
-			}
-		}
+		fp = _emummc_file_seek(sector);
+		if (!fp)
+			return 0;
 
-		if (f_open(&fp, emu_cfg.emummc_file_based_path, FA_WRITE))
+		if (f_write(fp, buf, (u64)num_sectors << 9, NULL))
 			return 0;
 
-		f_lseek(&fp, (u64)sector << 9);
-		if (f_write(&fp, buf, (u64)num_sectors << 9, NULL))
-		{
-			f_close(&fp);
+		// Commit the directory entry, as the handle stays open.
+		if (f_sync(fp))
 			return 0;
-		}
 
-		f_close(&fp);
 		return 1;
 	}
 }
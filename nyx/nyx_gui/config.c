@@ -62,7 +62,9 @@ void set_nyx_default_configuration()
 	n_cfg.timeoff = 0;
 	n_cfg.home_screen = 0;
 	n_cfg.verification = 1;
+	n_cfg.sparse_backup = 0;
 	n_cfg.ums_emmc_rw = 0;
+	n_cfg.ums_cache = 32;
 	n_cfg.jc_disable = 0;
 	n_cfg.new_powersave = 1;
 }
@@ -200,9 +202,15 @@ int create_nyx_config_entry()
 	f_puts("\nverification=", &fp);
 	itoa(n_cfg.verification, lbuf, 10);
 	f_puts(lbuf, &fp);
+	f_puts("\nsparsebackup=", &fp);
+	itoa(n_cfg.sparse_backup, lbuf, 10);
+	f_puts(lbuf, &fp);
 	f_puts("\numsemmcrw=", &fp);
 	itoa(n_cfg.ums_emmc_rw, lbuf, 10);
 	f_puts(lbuf, &fp);
+	f_puts("\numscache=", &fp);
+	itoa(n_cfg.ums_cache, lbuf, 10);
+	f_puts(lbuf, &fp);
 	f_puts("\njcdisable=", &fp);
 	itoa(n_cfg.jc_disable, lbuf, 10);
 	f_puts(lbuf, &fp);
@@ -49,7 +49,9 @@ typedef struct _nyx_config
 	u32 timeoff;
 	u32 home_screen;
 	u32 verification;
+	u32 sparse_backup;
 	u32 ums_emmc_rw;
+	u32 ums_cache;
 	u32 jc_disable;
 	u32 new_powersave;
 } nyx_config;
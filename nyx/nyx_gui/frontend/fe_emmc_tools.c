@@ -41,6 +41,21 @@
 #define NUM_SECTORS_PER_ITER 8192 // 4MB Cache.
 #define OUT_FILENAME_SZ 128
 #define HASH_FILENAME_SZ (OUT_FILENAME_SZ + 11) // 11 == strlen(".sha256sums")
+#define SPARSE_FILENAME_SZ (OUT_FILENAME_SZ + 7) // 7 == strlen(".sparse")
+
+#define VERIFY_HASHES_ADDR (SDXC_BUF_ALIGNED + 0x400000) // Chunk hashes of current file. After SD verification buffer.
+#define SPARSE_MAP_ADDR    (SDXC_BUF_ALIGNED + 0x800000) // Chunk map of current file.
+
+#define SPARSE_MAP_MAGIC 0x53505253 // "SPRS".
+
+typedef struct _sparse_map_t
+{
+	u32 magic;
+	u32 chunk_sectors; // Sectors per chunk.
+	u32 sectors;       // Sectors that the file represents.
+	u32 rsvd;
+	u8  bitmap[];      // Set: chunk is stored. Clear: chunk is all zeros and skipped.
+} sparse_map_t;
 
 extern nyx_config n_cfg;
 
@@ -144,11 +159,95 @@ static void _update_filename(char *outFilename, u32 sdPathLen, u32 currPartIdx)
 		itoa(currPartIdx, &outFilename[sdPathLen], 10);
 }
 
-static int _dump_emmc_verify(emmc_tool_gui_t *gui, sdmmc_storage_t *storage, u32 lba_curr, char *outFilename, emmc_part_t *part)
+static bool _sparse_chunk_is_zero(const u8 *buf, u32 size)
+{
+	const u32 *buf32 = (const u32 *)buf;
+	for (u32 i = 0; i < (size / sizeof(u32)); i += 4)
+		if (buf32[i] | buf32[i + 1] | buf32[i + 2] | buf32[i + 3])
+			return false;
+
+	return true;
+}
+
+static bool _sparse_map_get(sparse_map_t *map, u32 chunk_idx)
+{
+	return !map || (map->bitmap[chunk_idx >> 3] & BIT(chunk_idx & 7));
+}
+
+static void _sparse_map_set(sparse_map_t *map, u32 chunk_idx, bool stored)
+{
+	if (stored)
+		map->bitmap[chunk_idx >> 3] |= BIT(chunk_idx & 7);
+	else
+		map->bitmap[chunk_idx >> 3] &= ~BIT(chunk_idx & 7);
+}
+
+static u32 _sparse_map_size(sparse_map_t *map)
+{
+	u32 chunks = (map->sectors + map->chunk_sectors - 1) / map->chunk_sectors;
+
+	return sizeof(sparse_map_t) + ((chunks + 7) >> 3);
+}
+
+static int _sparse_map_save(char *outFilename, sparse_map_t *map)
+{
+	FIL fp;
+	char sparseFilename[SPARSE_FILENAME_SZ];
+	strcpy(sparseFilename, outFilename);
+	strcat(sparseFilename, ".sparse");
+
+	// Remove stale map, if file was fully backed up.
+	if (!map)
+	{
+		f_unlink(sparseFilename);
+		return FR_OK;
+	}
+
+	int res = f_open(&fp, sparseFilename, FA_CREATE_ALWAYS | FA_WRITE);
+	if (res)
+		return res;
+
+	res = f_write(&fp, map, _sparse_map_size(map), NULL);
+	f_close(&fp);
+
+	return res;
+}
+
+static sparse_map_t *_sparse_map_load(char *outFilename)
+{
+	FIL fp;
+	char sparseFilename[SPARSE_FILENAME_SZ];
+	strcpy(sparseFilename, outFilename);
+	strcat(sparseFilename, ".sparse");
+
+	if (f_open(&fp, sparseFilename, FA_READ))
+		return NULL;
+
+	sparse_map_t *map = (sparse_map_t *)SPARSE_MAP_ADDR;
+	u32 size = MIN(f_size(&fp), 0x400000);
+	int res = f_read(&fp, map, size, NULL);
+	f_close(&fp);
+
+	if (res || size < sizeof(sparse_map_t) || map->magic != SPARSE_MAP_MAGIC ||
+		map->chunk_sectors != NUM_SECTORS_PER_ITER || _sparse_map_size(map) > size)
+		return NULL;
+
+	return map;
+}
+
+static bool _dump_emmc_chunk_verified(u32 chunk_idx)
+{
+	// Check every time or every 4.
+	// Every 4 protects from fake sd, sector corruption and frequent I/O corruption.
+	// Full provides all that, plus protection from extremely rare I/O corruption.
+	return (n_cfg.verification >= 2) || !(chunk_idx % 4);
+}
+
+static int _dump_emmc_verify(emmc_tool_gui_t *gui, sdmmc_storage_t *storage, u32 lba_curr, char *outFilename, emmc_part_t *part, u8 *hashes, sparse_map_t *map)
 {
 	FIL fp;
 	FIL hashFp;
-	u8 sparseShouldVerify = 4;
+	u32 chunk_idx = 0;
 	u32 prevPct = 200;
 	u32 sdFileSector = 0;
 	int res = 0;
@@ -189,7 +288,8 @@ static int _dump_emmc_verify(emmc_tool_gui_t *gui, sdmmc_storage_t *storage, u32
 			f_puts("\n", &hashFp);
 		}
 
-		u32 totalSectorsVer = (u32)((u64)f_size(&fp) >> (u64)9);
+		// Sparse files only store the chunks that are not all zeros.
+		u32 totalSectorsVer = map ? map->sectors : (u32)((u64)f_size(&fp) >> (u64)9);
 
 		u8 *bufEm = (u8 *)EMMC_BUF_ALIGNED;
 		u8 *bufSd = (u8 *)SDXC_BUF_ALIGNED;
@@ -209,29 +309,33 @@ static int _dump_emmc_verify(emmc_tool_gui_t *gui, sdmmc_storage_t *storage, u32
 		{
 			num = MIN(totalSectorsVer, NUM_SECTORS_PER_ITER);
 
-			// Check every time or every 4.
-			// Every 4 protects from fake sd, sector corruption and frequent I/O corruption.
-			// Full provides all that, plus protection from extremely rare I/O corruption.
-			if ((n_cfg.verification >= 2) || !(sparseShouldVerify % 4))
+			bool chunk_stored = _sparse_map_get(map, chunk_idx);
+			if (chunk_stored && _dump_emmc_chunk_verified(chunk_idx))
 			{
-				if (!sdmmc_storage_read(storage, lba_curr, num, bufEm))
+				// Backups hash eMMC data while dumping. Only the SD copy needs to be read back.
+				if (hashes)
+					memcpy(hashEm, hashes + chunk_idx * SE_SHA_256_SIZE, SE_SHA_256_SIZE);
+				else
 				{
-					s_printf(gui->txt_buf,
-						"\n#FF0000 Failed to read %d blocks (@LBA %08X),#\n"
-						"#FF0000 from eMMC! Verification failed..#\n",
-						num, lba_curr);
-					lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
-					manual_system_maintenance(true);
+					if (!sdmmc_storage_read(storage, lba_curr, num, bufEm))
+					{
+						s_printf(gui->txt_buf,
+							"\n#FF0000 Failed to read %d blocks (@LBA %08X),#\n"
+							"#FF0000 from eMMC! Verification failed..#\n",
+							num, lba_curr);
+						lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
+						manual_system_maintenance(true);
 
-					free(clmt);
-					f_close(&fp);
-					if (n_cfg.verification == 3)
-						f_close(&hashFp);
+						free(clmt);
+						f_close(&fp);
+						if (n_cfg.verification == 3)
+							f_close(&hashFp);
 
-					return 1;
+						return 1;
+					}
+					manual_system_maintenance(false);
+					se_calc_sha256(hashEm, NULL, bufEm, num << 9, 0, SHA_INIT_HASH, false);
 				}
-				manual_system_maintenance(false);
-				se_calc_sha256(hashEm, NULL, bufEm, num << 9, 0, SHA_INIT_HASH, false);
 
 				f_lseek(&fp, (u64)sdFileSector << (u64)9);
 				if (f_read_fast(&fp, bufSd, num << 9))
@@ -251,7 +355,8 @@ static int _dump_emmc_verify(emmc_tool_gui_t *gui, sdmmc_storage_t *storage, u32
 					return 1;
 				}
 				manual_system_maintenance(false);
-				se_calc_sha256_finalize(hashEm, NULL);
+				if (!hashes)
+					se_calc_sha256_finalize(hashEm, NULL);
 				se_calc_sha256_oneshot(hashSd, bufSd, num << 9);
 				res = memcmp(hashEm, hashSd, SE_SHA_256_SIZE / 2);
 
@@ -303,8 +408,9 @@ static int _dump_emmc_verify(emmc_tool_gui_t *gui, sdmmc_storage_t *storage, u32
 
 			lba_curr += num;
 			totalSectorsVer -= num;
-			sdFileSector += num;
-			sparseShouldVerify++;
+			if (chunk_stored)
+				sdFileSector += num;
+			chunk_idx++;
 
 			// Check for cancellation combo.
 			if (btn_read_vol() == (BTN_VOL_UP | BTN_VOL_DOWN))
@@ -345,6 +451,24 @@ static int _dump_emmc_verify(emmc_tool_gui_t *gui, sdmmc_storage_t *storage, u32
 
 bool partial_sd_full_unmount = false;
 
+static int _dump_emmc_file_finish(FIL *fp, char *outFilename, sparse_map_t *map)
+{
+	int res = FR_OK;
+
+	// Drop the preallocated space that skipped chunks did not use.
+	if (map)
+	{
+		f_lseek(fp, f_tell(fp));
+		res = f_truncate(fp);
+	}
+	f_close(fp);
+
+	if (!res)
+		res = _sparse_map_save(outFilename, map);
+
+	return res;
+}
+
 static int _dump_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_part, sdmmc_storage_t *storage, emmc_part_t *part)
 {
 	const u32 FAT32_FILESIZE_LIMIT = 0xFFFFFFFF;
@@ -501,7 +625,30 @@ static int _dump_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_part,
 		return 0;
 	}
 
-	u8 *buf = (u8 *)MIXD_BUF_ALIGNED;
+	// Double buffered. Next chunk is read from eMMC while current one is written to SD.
+	u8 *bufs[2] = { (u8 *)MIXD_BUF_ALIGNED, (u8 *)MIXD_BUF_ALIGNED + NUM_SECTORS_PER_ITER * NX_EMMC_BLOCKSIZE };
+	u8 *buf = bufs[0];
+	u32 buf_idx = 0;
+	bool chunk_ready = false;
+	sdmmc_storage_req_t prefetch_req;
+	u64 time_read = 0;
+	u64 time_write = 0;
+	u32 time_start = get_tmr_ms();
+
+	// Chunks are hashed while backing up, so verification only needs to read back the SD copy.
+	u8 *hashes = n_cfg.verification ? (u8 *)VERIFY_HASHES_ADDR : NULL;
+	u32 chunk_idx = 0;
+
+	// Chunks that are all zeros are not written, if sparse backup is enabled.
+	sparse_map_t *map = n_cfg.sparse_backup ? (sparse_map_t *)SPARSE_MAP_ADDR : NULL;
+	u32 sparse_skipped = 0;
+	if (map)
+	{
+		map->magic = SPARSE_MAP_MAGIC;
+		map->chunk_sectors = NUM_SECTORS_PER_ITER;
+		map->sectors = 0;
+		map->rsvd = 0;
+	}
 
 	u32 lba_curr = part->lba_start;
 	u32 lbaStartPart = part->lba_start;
@@ -532,15 +679,24 @@ static int _dump_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_part,
 	{
 		if (numSplitParts != 0 && bytesWritten >= multipartSplitSize)
 		{
-			f_close(&fp);
+			res = _dump_emmc_file_finish(&fp, outFilename, map);
 			free(clmt);
 			memset(&fp, 0, sizeof(fp));
 			currPartIdx++;
 
-			if (n_cfg.verification && !gui->raw_emummc)
+			if (res)
+			{
+				s_printf(gui->txt_buf, "\n#FF0000 Error (%d) while finishing#\n#FFDD00 %s#\n", res, outFilename);
+				lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
+				manual_system_maintenance(true);
+
+				return 0;
+			}
+
+			if (n_cfg.verification)
 			{
 				// Verify part.
-				if (_dump_emmc_verify(gui, storage, lbaStartPart, outFilename, part))
+				if (_dump_emmc_verify(gui, storage, lbaStartPart, outFilename, part, hashes, map))
 				{
 					s_printf(gui->txt_buf, "#FFDD00 Please try again...#\n");
 					lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
@@ -608,6 +764,9 @@ static int _dump_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_part,
 			}
 
 			bytesWritten = 0;
+			chunk_idx = 0;
+			if (map)
+				map->sectors = 0;
 
 			totalSize = (u64)((u64)totalSectors << 9);
 			clmt = f_expand_cltbl(&fp, 0x400000, MIN(totalSize, multipartSplitSize));
@@ -615,12 +774,18 @@ static int _dump_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_part,
 
 		retryCount = 0;
 		num = MIN(totalSectors, NUM_SECTORS_PER_ITER);
+		buf = bufs[buf_idx];
 
-		int res_read;
-		if (!gui->raw_emummc)
-			res_read = !sdmmc_storage_read(storage, lba_curr, num, buf);
-		else
-			res_read = !sdmmc_storage_read(&sd_storage, lba_curr + sd_sector_off, num, buf);
+		// Read chunk if it was not prefetched.
+		int res_read = 0;
+		u32 time_taken = get_tmr_us();
+		if (!chunk_ready)
+		{
+			if (!gui->raw_emummc)
+				res_read = !sdmmc_storage_read(storage, lba_curr, num, buf);
+			else
+				res_read = !sdmmc_storage_read(&sd_storage, lba_curr + sd_sector_off, num, buf);
+		}
 
 		while (res_read)
 		{
@@ -650,10 +815,63 @@ static int _dump_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_part,
 				lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
 				manual_system_maintenance(true);
 			}
+
+			if (!gui->raw_emummc)
+				res_read = !sdmmc_storage_read(storage, lba_curr, num, buf);
+			else
+				res_read = !sdmmc_storage_read(&sd_storage, lba_curr + sd_sector_off, num, buf);
 		}
+		time_read += get_tmr_us() - time_taken;
 		manual_system_maintenance(false);
 
-		res = f_write_fast(&fp, buf, NX_EMMC_BLOCKSIZE * num);
+		// Prefetch next chunk, if eMMC is the source and no part switch follows.
+		u32 num_next = MIN(totalSectors - num, NUM_SECTORS_PER_ITER);
+		bool prefetch = !gui->raw_emummc && num_next &&
+			!(numSplitParts && (bytesWritten + num * NX_EMMC_BLOCKSIZE) >= multipartSplitSize);
+		if (prefetch)
+		{
+			prefetch_req.sector = lba_curr + num;
+			prefetch_req.num_sectors = num_next;
+			prefetch_req.buf = bufs[buf_idx ^ 1];
+			prefetch_req.is_write = 0;
+			prefetch_req.retries = 0;
+			prefetch_req.complete = NULL;
+			prefetch = sdmmc_storage_submit(storage, &prefetch_req);
+		}
+
+		// Skip chunk if it's all zeros and sparse backup is enabled.
+		bool chunk_stored = true;
+		if (map)
+		{
+			chunk_stored = !_sparse_chunk_is_zero(buf, num << 9);
+			_sparse_map_set(map, chunk_idx, chunk_stored);
+			map->sectors += num;
+			if (!chunk_stored)
+				sparse_skipped += num;
+		}
+
+		// Hash chunk in the background while it's written to SD.
+		bool hash_chunk = chunk_stored && n_cfg.verification && _dump_emmc_chunk_verified(chunk_idx);
+		if (hash_chunk)
+			se_calc_sha256(hashes + chunk_idx * SE_SHA_256_SIZE, NULL, buf, num << 9, 0, SHA_INIT_HASH, false);
+
+		time_taken = get_tmr_us();
+		res = chunk_stored ? f_write_fast(&fp, buf, NX_EMMC_BLOCKSIZE * num) : FR_OK;
+		time_write += get_tmr_us() - time_taken;
+
+		if (hash_chunk)
+			se_calc_sha256_finalize(hashes + chunk_idx * SE_SHA_256_SIZE, NULL);
+		chunk_idx++;
+
+		// Always wait for prefetch, so nothing is in flight afterwards. If it failed, it gets read again.
+		chunk_ready = false;
+		if (prefetch)
+		{
+			time_taken = get_tmr_us();
+			chunk_ready = sdmmc_storage_wait(storage) == SDMMC_ASYNC_DONE;
+			time_read += get_tmr_us() - time_taken;
+		}
+		buf_idx ^= 1;
 
 		if (res)
 		{
@@ -713,13 +931,31 @@ static int _dump_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_part,
 	manual_system_maintenance(true);
 
 	// Backup operation ended successfully.
-	f_close(&fp);
+	res = _dump_emmc_file_finish(&fp, outFilename, map);
 	free(clmt);
 
-	if (n_cfg.verification && !gui->raw_emummc)
+	if (res)
+	{
+		s_printf(gui->txt_buf, "\n#FF0000 Error (%d) while finishing#\n#FFDD00 %s#\n", res, outFilename);
+		lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
+		manual_system_maintenance(true);
+
+		return 0;
+	}
+
+	// Show time spent waiting on each stage.
+	u32 time_total = get_tmr_ms() - time_start;
+	s_printf(gui->txt_buf, "#96FF00 Read wait:# %d ms, #96FF00 Write:# %d ms, #96FF00 Total:# %d ms\n",
+		(u32)(time_read / 1000), (u32)(time_write / 1000), time_total);
+	if (map)
+		s_printf(gui->txt_buf + strlen(gui->txt_buf), "#96FF00 Sparse:# %d MiB of zeros skipped\n", sparse_skipped >> 11);
+	lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
+	manual_system_maintenance(true);
+
+	if (n_cfg.verification)
 	{
 		// Verify last part or single file backup.
-		if (_dump_emmc_verify(gui, storage, lbaStartPart, outFilename, part))
+		if (_dump_emmc_verify(gui, storage, lbaStartPart, outFilename, part, hashes, map))
 		{
 			s_printf(gui->txt_buf, "\n#FFDD00 Please try again...#\n");
 			lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
@@ -938,6 +1174,7 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 	u32 sdPathLen = strlen(sd_path);
 	u64 fileSize = 0;
 	u64 totalCheckFileSize = 0;
+	sparse_map_t *map = NULL;
 
 	FIL fp;
 	FILINFO fno;
@@ -995,9 +1232,12 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 				}
 				else
 				{
-					totalCheckFileSize += (u64)fno.fsize;
+					// Sparse parts represent more sectors than they store.
+					map = _sparse_map_load(outFilename);
+					u64 partSize = map ? ((u64)map->sectors << 9) : (u64)fno.fsize;
+					totalCheckFileSize += partSize;
 
-					if (check_4MB_aligned && (((u64)fno.fsize) % 0x400000))
+					if (check_4MB_aligned && (partSize % 0x400000))
 					{
 						s_printf(gui->txt_buf, "#FFDD00 The split file must be a#\n#FFDD00 multiple of 4 MiB.#\n#FFDD00 Aborting...#", res, outFilename);
 						lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
@@ -1059,6 +1299,12 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 			lv_label_ins_text(gui->label_info, LV_LABEL_POS_LAST, gui->txt_buf);
 	}
 	manual_system_maintenance(true);
+	if (!res)
+	{
+		map = _sparse_map_load(outFilename);
+		fileSize = map ? ((u64)map->sectors << 9) : (u64)f_size(&fp);
+	}
+
 	if (res)
 	{
 		if (res != FR_NO_FILE)
@@ -1076,7 +1322,7 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 
 		return 0;
 	}
-	else if (!use_multipart && (((u32)((u64)f_size(&fp) >> (u64)9)) != totalSectors)) // Check total restore size vs emmc size.
+	else if (!use_multipart && (((u32)((u64)fileSize >> (u64)9)) != totalSectors)) // Check total restore size vs emmc size.
 	{
 		if (!gui->raw_emummc)
 		{
@@ -1099,11 +1345,10 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 			}
 			lv_obj_del(warn_mbox_bg);
 		}
-		totalSectors = (u32)((u64)f_size(&fp) >> (u64)9);
+		totalSectors = (u32)((u64)fileSize >> (u64)9);
 	}
 	else
 	{
-		fileSize = (u64)f_size(&fp);
 		s_printf(gui->txt_buf, "\nTotal restore size: %d MiB.\n",
 			(u32)((use_multipart ? (u64)totalCheckFileSize : fileSize) >> (u64)9) >> SECTORS_TO_MIB_COEFF);
 		lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
@@ -1111,6 +1356,10 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 	}
 
 	u8 *buf = (u8 *)MIXD_BUF_ALIGNED;
+	u8 *buf_zero = (u8 *)MIXD_BUF_ALIGNED + NUM_SECTORS_PER_ITER * NX_EMMC_BLOCKSIZE;
+	bool buf_zero_ready = false;
+	bool trim_supported = !gui->raw_emummc;
+	u32 chunk_idx = 0;
 
 	u32 lba_curr = part->lba_start;
 	u32 bytesWritten = 0;
@@ -1156,7 +1405,7 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 			if (n_cfg.verification && !gui->raw_emummc)
 			{
 				// Verify part.
-				if (_dump_emmc_verify(gui, storage, lbaStartPart, outFilename, part))
+				if (_dump_emmc_verify(gui, storage, lbaStartPart, outFilename, part, NULL, map))
 				{
 					s_printf(gui->txt_buf, "\n#FFDD00 Please try again...#\n");
 					lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
@@ -1188,15 +1437,36 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 
 				return 0;
 			}
-			fileSize = (u64)f_size(&fp);
+			map = _sparse_map_load(outFilename);
+			fileSize = map ? ((u64)map->sectors << 9) : (u64)f_size(&fp);
 			bytesWritten = 0;
+			chunk_idx = 0;
 			clmt = f_expand_cltbl(&fp, 0x400000, 0);
 		}
 
 		retryCount = 0;
 		num = MIN(totalSectors, NUM_SECTORS_PER_ITER);
 
-		res = f_read_fast(&fp, buf, num << 9);
+		// Zero chunks are not stored in sparse backups. Trim them or write zeros instead.
+		u8 *src = buf;
+		bool trimmed = false;
+		if (_sparse_map_get(map, chunk_idx))
+			res = f_read_fast(&fp, buf, num << 9);
+		else
+		{
+			res = FR_OK;
+			if (trim_supported)
+				trimmed = sdmmc_storage_trim_mmc(storage, lba_curr, num);
+			trim_supported = trimmed;
+
+			if (!trimmed && !buf_zero_ready)
+			{
+				memset(buf_zero, 0, NUM_SECTORS_PER_ITER * NX_EMMC_BLOCKSIZE);
+				buf_zero_ready = true;
+			}
+			src = buf_zero;
+		}
+		chunk_idx++;
 		manual_system_maintenance(false);
 
 		if (res)
@@ -1212,10 +1482,12 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 			free(clmt);
 			return 0;
 		}
-		if (!gui->raw_emummc)
-			res = !sdmmc_storage_write(storage, lba_curr, num, buf);
+		if (trimmed)
+			res = 0;
+		else if (!gui->raw_emummc)
+			res = !sdmmc_storage_write(storage, lba_curr, num, src);
 		else
-			res = !sdmmc_storage_write(&sd_storage, lba_curr + sd_sector_off, num, buf);
+			res = !sdmmc_storage_write(&sd_storage, lba_curr + sd_sector_off, num, src);
 
 		manual_system_maintenance(false);
 
@@ -1248,9 +1520,9 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 				manual_system_maintenance(true);
 			}
 			if (!gui->raw_emummc)
-				res = !sdmmc_storage_write(storage, lba_curr, num, buf);
+				res = !sdmmc_storage_write(storage, lba_curr, num, src);
 			else
-				res = !sdmmc_storage_write(&sd_storage, lba_curr + sd_sector_off, num, buf);
+				res = !sdmmc_storage_write(&sd_storage, lba_curr + sd_sector_off, num, src);
 			manual_system_maintenance(false);
 		}
 		pct = (u64)((u64)(lba_curr - part->lba_start) * 100u) / (u64)(part->lba_end - part->lba_start);
@@ -1278,7 +1550,7 @@ static int _restore_emmc_part(emmc_tool_gui_t *gui, char *sd_path, int active_pa
 	if (n_cfg.verification && !gui->raw_emummc)
 	{
 		// Verify restored data.
-		if (_dump_emmc_verify(gui, storage, lbaStartPart, outFilename, part))
+		if (_dump_emmc_verify(gui, storage, lbaStartPart, outFilename, part, NULL, map))
 		{
 			s_printf(gui->txt_buf, "#FFDD00 Please try again...#\n");
 			lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
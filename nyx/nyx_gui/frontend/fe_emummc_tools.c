@@ -689,6 +689,14 @@ static int _dump_emummc_raw_part(emmc_tool_gui_t *gui, int active_part, int part
 		nx_emmc_bis_end();
 		hos_bis_keys_clear();
 
+		// Report BIS cache efficiency.
+		nx_emmc_bis_stats_t bis_stats;
+		nx_emmc_bis_get_stats(&bis_stats);
+		s_printf(gui->txt_buf, "BIS cache: %d hits, %d misses, %d evictions, %d write-backs\n",
+			bis_stats.hits, bis_stats.misses, bis_stats.evictions, bis_stats.writebacks);
+		lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
+		manual_system_maintenance(true);
+
 		s_printf(gui->txt_buf, "Writing new GPT... ");
 		lv_label_ins_text(gui->label_log, LV_LABEL_POS_LAST, gui->txt_buf);
 		manual_system_maintenance(true);
@@ -31,6 +31,7 @@
 #include <gfx_utils.h>
 #include <input/joycon.h>
 #include <input/touch.h>
+#include <libs/compr/lz4.h>
 #include <libs/fatfs/ff.h>
 #include <mem/heap.h>
 #include <mem/minerva.h>
@@ -61,6 +62,27 @@ extern lv_res_t launch_payload(lv_obj_t *list);
 static bool disp_init_done = false;
 static bool do_reload = false;
 
+#define DISP_DIRTY_AREAS_MAX 32
+
+typedef struct _disp_dirty_t
+{
+	u32 cnt;
+	bool full;
+	lv_area_t area[DISP_DIRTY_AREAS_MAX];
+} disp_dirty_t;
+
+typedef struct _disp_fb_ctx_t
+{
+	u32 *front;
+	u32 *back;
+	bool drawing;
+	bool flipped;
+	disp_dirty_t dirty;      // Areas drawn to back buffer in current frame.
+	disp_dirty_t dirty_prev; // Areas drawn to front buffer in previous frame.
+} disp_fb_ctx_t;
+
+static disp_fb_ctx_t disp_fb = { (u32 *)NYX_FB2_ADDRESS, (u32 *)NYX_FB_ADDRESS };
+
 lv_style_t hint_small_style;
 lv_style_t hint_small_style_white;
 lv_style_t monospace_text;
@@ -213,7 +235,7 @@ static void _save_fb_to_bmp()
 	const u32 file_size = 0x384000 + 0x36;
 	u8 *bitmap = malloc(file_size);
 	u32 *fb = malloc(0x384000);
-	u32 *fb_ptr = (u32 *)NYX_FB_ADDRESS;
+	u32 *fb_ptr = disp_fb.flipped ? disp_fb.front : disp_fb.back;
 
 	// Reconstruct FB for bottom-top, landscape bmp.
 	for (u32 x = 0; x < 1280; x++)
@@ -316,10 +338,83 @@ static void _save_fb_to_bmp()
 	timer = get_tmr_ms() + 2000;
 }
 
+static void _disp_fb_copy_area(const lv_area_t *area)
+{
+	gfx_copy_rect_land_pitch(disp_fb.back, disp_fb.front, 720, area->x1, area->y1, area->x2, area->y2);
+}
+
+static void _disp_fb_replay()
+{
+	// Wait for previous flip to get latched, so front buffer is not scanned out anymore.
+	u32 timeout = get_tmr_us() + 50000;
+	while (display_framebuffer_flip_pending() && get_tmr_us() < timeout)
+		;
+
+	// Bring back buffer up to date with the areas of the previous frame.
+	disp_dirty_t *dirty = &disp_fb.dirty_prev;
+	if (dirty->full)
+	{
+		lv_area_t area = { 0, 0, LV_HOR_RES - 1, LV_VER_RES - 1 };
+		_disp_fb_copy_area(&area);
+	}
+	else
+	{
+		for (u32 i = 0; i < dirty->cnt; i++)
+			_disp_fb_copy_area(&dirty->area[i]);
+	}
+
+	dirty->cnt = 0;
+	dirty->full = false;
+}
+
+static void _disp_fb_flip(uint32_t time, uint32_t px_num)
+{
+	// Flip only when display is configured and a frame was drawn.
+	if (!disp_init_done || !disp_fb.drawing)
+		return;
+
+	// Scan out back buffer. DC latches it on next vblank, so drawing can continue.
+	display_set_framebuffer(disp_fb.back);
+
+	u32 *fb = disp_fb.front;
+	disp_fb.front = disp_fb.back;
+	disp_fb.back = fb;
+
+	// New back buffer is missing everything drawn in this frame. On first flip, it was never drawn.
+	memcpy(&disp_fb.dirty_prev, &disp_fb.dirty, sizeof(disp_dirty_t));
+	if (!disp_fb.flipped)
+		disp_fb.dirty_prev.full = true;
+
+	disp_fb.dirty.cnt = 0;
+	disp_fb.dirty.full = false;
+	disp_fb.drawing = false;
+	disp_fb.flipped = true;
+}
+
 static void _disp_fb_flush(int32_t x1, int32_t y1, int32_t x2, int32_t y2, const lv_color_t *color_p)
 {
-	// Draw to framebuffer.
-	gfx_set_rect_land_pitch((u32 *)NYX_FB_ADDRESS, (u32 *)color_p, 720, x1, y1, x2, y2); //pitch
+	// Sync back buffer on first area of a new frame.
+	if (!disp_fb.drawing)
+	{
+		_disp_fb_replay();
+		disp_fb.drawing = true;
+	}
+
+	// Draw to back framebuffer.
+	gfx_set_rect_land_pitch(disp_fb.back, (u32 *)color_p, 720, x1, y1, x2, y2); //pitch
+
+	// Track dirty area for the next frame.
+	disp_dirty_t *dirty = &disp_fb.dirty;
+	if (dirty->cnt < DISP_DIRTY_AREAS_MAX)
+	{
+		lv_area_t *area = &dirty->area[dirty->cnt++];
+		area->x1 = x1;
+		area->y1 = y1;
+		area->x2 = x2;
+		area->y2 = y2;
+	}
+	else
+		dirty->full = true;
 
 	// Check if display init was done. If it's the first big draw, init.
 	if (!disp_init_done && ((x2 - x1 + 1) > 600))
@@ -1358,8 +1453,42 @@ static lv_res_t _launch_more_cfg_action(lv_obj_t *btn)
 	return LV_RES_OK;
 }
 
+typedef struct _launch_icon_t
+{
+	char *name;
+	char *path;
+	bool payload;
+	lv_obj_t *img;
+} launch_icon_t;
+
+static launch_icon_t launch_icons[8];
+static lv_task_t *launch_icons_task = NULL;
+static lv_style_t launch_icon_style;
+static bool launch_icon_sw_custom;
+static bool launch_icon_pl_custom;
+
+static void _launch_icons_cancel()
+{
+	if (launch_icons_task)
+	{
+		lv_task_del(launch_icons_task);
+		launch_icons_task = NULL;
+		sd_unmount();
+	}
+
+	for (u32 i = 0; i < 8; i++)
+	{
+		free(launch_icons[i].name);
+		free(launch_icons[i].path);
+	}
+	memset(launch_icons, 0, sizeof(launch_icons));
+}
+
 static lv_res_t _win_launch_close_action(lv_obj_t * btn)
 {
+	// Stop loading icons.
+	_launch_icons_cancel();
+
 	// Cleanup icons.
 	for (u32 i = 0; i < 8; i++)
 	{
@@ -1373,8 +1502,8 @@ static lv_res_t _win_launch_close_action(lv_obj_t * btn)
 
 			lv_img_dsc_t *src = (lv_img_dsc_t *)lv_img_get_src(img);
 
-			// Avoid freeing base icons.
-			if ((src != icon_switch) && (src != icon_payload))
+			// Avoid freeing base icons. Not yet loaded icons have no source.
+			if (src && (src != icon_switch) && (src != icon_payload))
 				free(src);
 		}
 	}
@@ -1487,9 +1616,232 @@ static const launch_button_pos_t launch_button_pos[8] = {
 	{ 982, 313, 963, 522 }
 };
 
+#define ICON_CACHE_MAGIC   0x4E434349 // "ICCN".
+#define ICON_CACHE_VERSION 2
+#define ICON_CACHE_PATH_SZ 0x80
+
+typedef struct _icon_cache_hdr_t
+{
+	u32 magic;
+	u32 version;
+	u32 src_size;
+	u16 src_date;
+	u16 src_time;
+	lv_img_header_t header;
+	u32 data_size;
+	u32 comp_size; // 0: Stored uncompressed.
+	u32 rsvd;
+	char src_path[ICON_CACHE_PATH_SZ]; // File name is only a hash of it.
+} icon_cache_hdr_t;
+
+static u32 _icon_cache_data_size(lv_img_header_t *header)
+{
+	return header->w * header->h * sizeof(lv_color_t);
+}
+
+static void _icon_cache_path(const char *path, char *cache_path)
+{
+	strcpy(cache_path, "bootloader/cache/icons/");
+	itoa(crc32_calc(0, (const u8 *)path, strlen(path)), cache_path + strlen(cache_path), 16);
+	strcat(cache_path, ".bin");
+}
+
+static lv_img_dsc_t *_icon_cache_load(const char *path, const char *cache_path, FILINFO *fno)
+{
+	u32 fsize;
+	icon_cache_hdr_t *hdr = (icon_cache_hdr_t *)sd_file_read(cache_path, &fsize);
+	if (!hdr)
+		return NULL;
+
+	lv_img_dsc_t *img_desc = NULL;
+	if (fsize < sizeof(icon_cache_hdr_t))
+		goto out;
+
+	// Check that cache matches the source bmp.
+	u32 stored_size = hdr->comp_size ? hdr->comp_size : hdr->data_size;
+	if (hdr->magic != ICON_CACHE_MAGIC || hdr->version != ICON_CACHE_VERSION ||
+		hdr->src_size != fno->fsize || hdr->src_date != fno->fdate || hdr->src_time != fno->ftime ||
+		strncmp(hdr->src_path, path, ICON_CACHE_PATH_SZ) ||
+		hdr->data_size != _icon_cache_data_size(&hdr->header) ||
+		fsize != sizeof(icon_cache_hdr_t) + stored_size)
+		goto out;
+
+	// Icon data is already flipped and in LVGL format. Only decompress it.
+	u32 offset_copy = ALIGN(sizeof(lv_img_dsc_t), 0x10);
+	img_desc = (lv_img_dsc_t *)malloc(offset_copy + hdr->data_size);
+	u8 *data = (u8 *)img_desc + offset_copy;
+	u8 *src = (u8 *)hdr + sizeof(icon_cache_hdr_t);
+
+	if (hdr->comp_size)
+	{
+		if (LZ4_decompress_safe((const char *)src, (char *)data, hdr->comp_size, hdr->data_size) != (int)hdr->data_size)
+		{
+			free(img_desc);
+			img_desc = NULL;
+			goto out;
+		}
+	}
+	else
+		memcpy(data, src, hdr->data_size);
+
+	img_desc->header = hdr->header;
+	img_desc->data_size = hdr->data_size;
+	img_desc->data = data;
+
+out:
+	free(hdr);
+
+	return img_desc;
+}
+
+static void _icon_cache_save(const char *path, const char *cache_path, FILINFO *fno, lv_img_dsc_t *img_desc)
+{
+	// Only the pixels are stored. BMP data might have padding after them.
+	u32 data_size = _icon_cache_data_size(&img_desc->header);
+	if (data_size > img_desc->data_size)
+		return;
+
+	u32 bound = LZ4_compressBound(data_size);
+	u8 *buf = malloc(sizeof(icon_cache_hdr_t) + MAX(bound, data_size));
+	icon_cache_hdr_t *hdr = (icon_cache_hdr_t *)buf;
+	u8 *dst = buf + sizeof(icon_cache_hdr_t);
+
+	memset(hdr, 0, sizeof(icon_cache_hdr_t));
+	hdr->magic = ICON_CACHE_MAGIC;
+	hdr->version = ICON_CACHE_VERSION;
+	hdr->src_size = fno->fsize;
+	hdr->src_date = fno->fdate;
+	hdr->src_time = fno->ftime;
+	hdr->header = img_desc->header;
+	hdr->data_size = data_size;
+	strcpy(hdr->src_path, path);
+
+	// Store uncompressed if it doesn't compress.
+	int comp_size = LZ4_compress_default((const char *)img_desc->data, (char *)dst, data_size, bound);
+	if (comp_size > 0 && (u32)comp_size < data_size)
+		hdr->comp_size = comp_size;
+	else
+		memcpy(dst, img_desc->data, data_size);
+
+	f_mkdir("bootloader/cache");
+	f_mkdir("bootloader/cache/icons");
+	sd_save_to_file(buf, sizeof(icon_cache_hdr_t) + (hdr->comp_size ? hdr->comp_size : hdr->data_size), cache_path);
+
+	free(buf);
+}
+
+static lv_img_dsc_t *_launch_icon_load(const char *path)
+{
+	FILINFO fno;
+	if (f_stat(path, &fno))
+		return NULL;
+
+	// Paths too long to be stored in cache are not cached.
+	if (strlen(path) >= ICON_CACHE_PATH_SZ)
+		return bmp_to_lvimg_obj(path);
+
+	// Cache is keyed by path. Size and date invalidate it.
+	char cache_path[48];
+	_icon_cache_path(path, cache_path);
+
+	lv_img_dsc_t *img_desc = _icon_cache_load(path, cache_path, &fno);
+	if (img_desc)
+		return img_desc;
+
+	img_desc = bmp_to_lvimg_obj(path);
+	if (img_desc)
+		_icon_cache_save(path, cache_path, &fno, img_desc);
+
+	return img_desc;
+}
+
+static void _launch_icons_load_task(void *param)
+{
+	// Load one icon per run, so the window gets drawn before all icons are ready.
+	launch_icon_t *icon = NULL;
+	for (u32 i = 0; i < 8; i++)
+	{
+		if (launch_icons[i].name)
+		{
+			icon = &launch_icons[i];
+			break;
+		}
+	}
+
+	if (!icon)
+	{
+		_launch_icons_cancel();
+		return;
+	}
+
+	bool img_colorize = false;
+	lv_img_dsc_t *bmp = NULL;
+
+	if (!sd_mount())
+		goto out;
+
+	// If icon not found, check res folder for section_name.bmp.
+	// If not, use defaults.
+	if (!icon->path)
+	{
+		char *tmp_path = malloc(1024);
+
+		s_printf(tmp_path, "bootloader/res/%s.bmp", icon->name);
+		bmp = _launch_icon_load(tmp_path);
+		if (!bmp)
+		{
+			s_printf(tmp_path, "bootloader/res/%s_hue.bmp", icon->name);
+			bmp = _launch_icon_load(tmp_path);
+			if (bmp)
+				img_colorize = true;
+		}
+
+		free(tmp_path);
+
+		if (!bmp && icon->payload)
+		{
+			bmp = icon_payload;
+
+			if (!launch_icon_pl_custom)
+				img_colorize = true;
+		}
+	}
+	else
+	{
+		bmp = _launch_icon_load(icon->path);
+
+		// Check if colorization is enabled.
+		if (bmp && strlen(icon->path) > 8 && !memcmp(icon->path + strlen(icon->path) - 8, "_hue", 4))
+			img_colorize = true;
+	}
+
+out:
+	// Default to switch logo if no icon found at all.
+	if (!bmp)
+	{
+		bmp = icon_switch;
+
+		if (!launch_icon_sw_custom)
+			img_colorize = true;
+	}
+
+	//Set icon.
+	if (bmp)
+	{
+		if (img_colorize)
+			lv_img_set_style(icon->img, &launch_icon_style);
+
+		lv_img_set_src(icon->img, bmp);
+		lv_obj_align(icon->img, NULL, LV_ALIGN_CENTER, 0, 0);
+	}
+
+	free(icon->name);
+	free(icon->path);
+	memset(icon, 0, sizeof(launch_icon_t));
+}
+
 static lv_res_t _create_window_home_launch(lv_obj_t *btn)
 {
-	char *icon_path;
 
 	static lv_style_t btn_home_transp_rel;
 	lv_style_copy(&btn_home_transp_rel, lv_theme_get_current()->btn.rel);
@@ -1587,21 +1939,22 @@ static lv_res_t _create_window_home_launch(lv_obj_t *btn)
 	}
 
 	// Create colorized icon style based on its parrent style.
-	static lv_style_t img_style;
-	lv_style_copy(&img_style, &lv_style_plain);
-	img_style.image.color = lv_color_hsv_to_rgb(n_cfg.themecolor, 100, 100);
-	img_style.image.intense = LV_OPA_COVER;
+	lv_style_copy(&launch_icon_style, &lv_style_plain);
+	launch_icon_style.image.color = lv_color_hsv_to_rgb(n_cfg.themecolor, 100, 100);
+	launch_icon_style.image.intense = LV_OPA_COVER;
 
 	// Parse ini boot entries and set buttons/icons.
-	char *tmp_path = malloc(1024);
 	u32 curr_btn_idx = 0; // Active buttons.
 	LIST_INIT(ini_sections);
 
+	// Drop any icons still pending from a previous window.
+	_launch_icons_cancel();
+
 	if (sd_mount())
 	{
 		// Check if we use custom system icons.
-		bool icon_sw_custom = !f_stat("bootloader/res/icon_switch_custom.bmp", NULL);
-		bool icon_pl_custom = !f_stat("bootloader/res/icon_payload_custom.bmp", NULL);
+		launch_icon_sw_custom = !f_stat("bootloader/res/icon_switch_custom.bmp", NULL);
+		launch_icon_pl_custom = !f_stat("bootloader/res/icon_payload_custom.bmp", NULL);
 
 		// Choose what to parse.
 		bool ini_parse_success = false;
@@ -1630,82 +1983,34 @@ ini_parsing:
 				if (!strcmp(ini_sec->name, "config") || (ini_sec->type != INI_CHOICE))
 					continue;
 
-				icon_path = NULL;
-				bool payload = false;
-				bool img_colorize = false;
-				lv_img_dsc_t *bmp = NULL;
-				lv_obj_t *img = NULL;
+				launch_icon_t *icon = &launch_icons[curr_btn_idx >> 1];
 
 				// Check for icons.
 				LIST_FOREACH_ENTRY(ini_kv_t, kv, &ini_sec->kvs, link)
 				{
 					if (!strcmp("icon", kv->key))
-						icon_path = kv->val;
-					else if (!strcmp("payload", kv->key))
-						payload = true;
-				}
-
-				// If icon not found, check res folder for section_name.bmp.
-				// If not, use defaults.
-				if (!icon_path)
-				{
-					s_printf(tmp_path, "bootloader/res/%s.bmp", ini_sec->name);
-					bmp = bmp_to_lvimg_obj(tmp_path);
-					if (!bmp)
 					{
-						s_printf(tmp_path, "bootloader/res/%s_hue.bmp", ini_sec->name);
-						bmp = bmp_to_lvimg_obj(tmp_path);
-						if (bmp)
-							img_colorize = true;
+						free(icon->path);
+						icon->path = malloc(strlen(kv->val) + 1);
+						strcpy(icon->path, kv->val);
 					}
-
-					if (!bmp && payload)
-					{
-						bmp = icon_payload;
-
-						if (!icon_pl_custom)
-							img_colorize = true;
-					}
-				}
-				else
-				{
-					bmp = bmp_to_lvimg_obj(icon_path);
-
-					// Check if colorization is enabled.
-					if (bmp && strlen(icon_path) > 8 && !memcmp(icon_path + strlen(icon_path) - 8, "_hue", 4))
-						img_colorize = true;
+					else if (!strcmp("payload", kv->key))
+						icon->payload = true;
 				}
 
 				// Enable button.
 				lv_obj_set_opa_scale(launch_ctxt[curr_btn_idx], LV_OPA_COVER);
 
-				// Default to switch logo if no icon found at all.
-				if (!bmp)
-				{
-					bmp = icon_switch;
-
-					if (!icon_sw_custom)
-						img_colorize = true;
-				}
-
-				//Set icon.
-				if (bmp)
-				{
-					img = lv_img_create(launch_ctxt[curr_btn_idx], NULL);
-
-					if (img_colorize)
-						lv_img_set_style(img, &img_style);
-
-					lv_img_set_src(img, bmp);
-				}
+				// Icon gets loaded lazily after the window is drawn.
+				icon->name = malloc(strlen(ini_sec->name) + 1);
+				strcpy(icon->name, ini_sec->name);
+				icon->img = lv_img_create(launch_ctxt[curr_btn_idx], NULL);
 
 				// Add button mask/radius and align icon.
 				lv_obj_t *btn = lv_btn_create(launch_ctxt[curr_btn_idx], NULL);
 				lv_obj_set_size(btn, 200, 200);
 				lv_btn_set_style(btn, LV_BTN_STYLE_REL, &btn_home_transp_rel);
 				lv_btn_set_style(btn, LV_BTN_STYLE_PR, &btn_home_transp_pr);
-				if (img)
-					lv_obj_align(img, NULL, LV_ALIGN_CENTER, 0, 0);
 
 				// Set autoboot index.
 				ext = lv_obj_get_ext_attr(btn);
@@ -1742,9 +2047,11 @@ ini_parsing:
 	if (curr_btn_idx < 2)
 		no_boot_entries = true;
 
-	sd_unmount();
-
-	free(tmp_path);
+	// Load icons in the background. SD stays mounted until all are loaded.
+	if (!no_boot_entries)
+		launch_icons_task = lv_task_create(_launch_icons_load_task, 1, LV_TASK_PRIO_LOW, NULL);
+	else
+		sd_unmount();
 
 	// No boot entries found.
 	if (no_boot_entries)
@@ -2279,6 +2586,9 @@ void nyx_load_and_run()
 	disp_drv.disp_flush = _disp_fb_flush;
 	lv_disp_drv_register(&disp_drv);
 
+	// Flip framebuffers when a frame is fully drawn.
+	lv_refr_set_monitor_cb(_disp_fb_flip);
+
 	// Initialize Joy-Con.
 	if (!n_cfg.jc_disable)
 	{
@@ -1423,6 +1423,68 @@ static lv_res_t _create_mbox_benchmark(bool sd_bench)
 			free(random_offsets);
 		}
 
+		// Benchmark BIS reads with XTS decryption. Keyslot contents do not affect throughput.
+		if (!sd_bench)
+		{
+			LIST_INIT(gpt);
+			nx_emmc_gpt_parse(&gpt, &emmc_storage);
+			emmc_part_t *system_part = nx_emmc_part_find(&gpt, "SYSTEM");
+			if (system_part)
+			{
+				u32 pct = 0;
+				u32 prevPct = 200;
+				u32 timer = 0;
+				u32 lba_curr = 0;
+				u32 sector_num = 0x2000;      // 4MB chunks.
+				u32 data_remaining = 0x80000; // 256MB.
+
+				s_printf(txt_buf + strlen(txt_buf), "#C7EA46 BIS# - Partition #C7EA46 SYSTEM#:\n");
+
+				nx_emmc_bis_init(system_part, false, 0);
+				while (data_remaining)
+				{
+					u32 time_taken = get_tmr_us();
+					nx_emmc_bis_read(lba_curr, sector_num, (u8 *)MIXD_BUF_ALIGNED);
+					time_taken = get_tmr_us() - time_taken;
+					timer += time_taken;
+
+					manual_system_maintenance(false);
+					data_remaining -= sector_num;
+					lba_curr += sector_num;
+
+					pct = (lba_curr * 100) / 0x80000;
+					if (pct != prevPct)
+					{
+						lv_bar_set_value(bar, pct);
+						manual_system_maintenance(true);
+
+						prevPct = pct;
+
+						if (btn_read_vol() == (BTN_VOL_UP | BTN_VOL_DOWN))
+							break;
+					}
+				}
+				nx_emmc_bis_end();
+				lv_bar_set_value(bar, 100);
+
+				// Only count what was read, in case it was aborted.
+				if (!data_remaining && timer)
+				{
+					u32 rate_1k = ((u64)lba_curr * 1000 * 1000 * 1000 / 2048) / timer;
+					s_printf(txt_buf + strlen(txt_buf),
+						" Decrypted   4MiB - Rate: #C7EA46 %3d.%02d MiB/s#\n",
+						rate_1k / 1000, (rate_1k % 1000) / 10);
+				}
+				else
+					s_printf(txt_buf + strlen(txt_buf), " Decrypted   4MiB - #FFDD00 Aborted!#\n");
+				lv_label_set_text(lbl_status, txt_buf);
+				lv_obj_align(lbl_status, NULL, LV_ALIGN_CENTER, 0, 0);
+				lv_obj_align(mbox, NULL, LV_ALIGN_CENTER, 0, 0);
+				manual_system_maintenance(true);
+			}
+			nx_emmc_gpt_free(&gpt);
+		}
+
 		lv_obj_del(bar);
 
 		if (sd_bench)
@@ -1904,7 +1966,9 @@ static lv_res_t _create_window_sdcard_info_status(lv_obj_t *btn)
 			"#00DDFF SDMMC1 Errors:#\n"
 			"Init fails:\n"
 			"Read/Write fails:\n"
-			"Read/Write errors:"
+			"Read/Write errors:\n"
+			"Reinits (clean xfers):\n"
+			"Latency <1/4/16/+ ms:"
 		);
 		lv_obj_set_size(desc4, LV_HOR_RES / 2 / 5 * 2, LV_VER_RES - (LV_DPI * 11 / 8) * 4);
 		lv_obj_set_width(lb_desc4, lv_obj_get_width(desc4));
@@ -1919,6 +1983,16 @@ static lv_res_t _create_window_sdcard_info_status(lv_obj_t *btn)
 		s_printf(txt_buf, "\n%d (%d)\n%d (%d)\n%d (%d)",
 			sd_errors[0], nyx_str->info.sd_errors[0], sd_errors[1], nyx_str->info.sd_errors[1], sd_errors[2], nyx_str->info.sd_errors[2]);
 
+		// Latency histogram folded to 4 bins as percentage of transfers.
+		sdmmc_storage_stats_t *stats = &sd_storage.stats;
+		u32 lat[4] = { 0 };
+		for (u32 i = 0; i < SDMMC_LAT_BUCKETS; i++)
+			lat[MIN((i + 1) / 2, 3)] += stats->lat[i];
+		u32 xfers = MAX(stats->xfers, 1);
+		s_printf(txt_buf + strlen(txt_buf), "\n%d (%d)\n%d/%d/%d/%d%%",
+			stats->reinits, stats->clean,
+			lat[0] * 100 / xfers, lat[1] * 100 / xfers, lat[2] * 100 / xfers, lat[3] * 100 / xfers);
+
 		lv_label_set_text(lb_val4, txt_buf);
 
 		lv_obj_set_width(lb_val4, lv_obj_get_width(val4));
@@ -2175,6 +2249,225 @@ static lv_res_t _create_window_battery_status(lv_obj_t *btn)
 	return LV_RES_OK;
 }
 
+typedef struct _btrace_span_t
+{
+	char name[BTRACE_NAME_LEN];
+	u8   depth;
+	bool done;
+	u32  session;
+	u32  start;
+	u32  duration;
+} btrace_span_t;
+
+#define BTRACE_MAX_DEPTH 8
+
+static u32 _btrace_spans_get(btrace_span_t **out_spans)
+{
+	u32 ev_cnt;
+	btrace_event_t *events = btrace_get((btrace_t *)&nyx_str->info.trace, &ev_cnt);
+	if (!events)
+		return 0;
+
+	btrace_span_t *spans = (btrace_span_t *)calloc(ev_cnt, sizeof(btrace_span_t));
+	u32 stack[BTRACE_MAX_DEPTH];
+	u32 depth = 0;
+	u32 session = 0;
+	u32 base = 0;
+	u32 cnt = 0;
+
+	for (u32 i = 0; i < ev_cnt; i++)
+	{
+		btrace_event_t *ev = &events[i];
+
+		if (ev->type == BTRACE_MARK)
+		{
+			session++;
+			base = ev->ts;
+			depth = 0;
+			continue;
+		}
+
+		// Skip events without their session mark. Ring was overwritten.
+		if (!session)
+			continue;
+
+		if (ev->type == BTRACE_BEGIN)
+		{
+			btrace_span_t *span = &spans[cnt];
+			strcpy(span->name, ev->name);
+			span->depth = depth;
+			span->session = session;
+			span->start = ev->ts - base;
+
+			if (depth < BTRACE_MAX_DEPTH)
+				stack[depth++] = cnt;
+			cnt++;
+		}
+		else
+		{
+			// Find matching begin. Any inner spans that were not ended are left incomplete.
+			for (int j = depth - 1; j >= 0; j--)
+			{
+				btrace_span_t *span = &spans[stack[j]];
+				if (!strcmp(span->name, ev->name))
+				{
+					span->duration = ev->ts - base - span->start;
+					span->done = true;
+					depth = j;
+					break;
+				}
+			}
+		}
+	}
+
+	free(events);
+
+	if (!cnt)
+	{
+		free(spans);
+		return 0;
+	}
+
+	*out_spans = spans;
+
+	return cnt;
+}
+
+static lv_res_t _btrace_save_csv_action(lv_obj_t * btn)
+{
+	btrace_span_t *spans;
+	u32 cnt = _btrace_spans_get(&spans);
+	if (!cnt)
+	{
+		_create_window_dump_done(1, "boot_trace.csv");
+		return LV_RES_OK;
+	}
+
+	int error = !sd_mount();
+	if (!error)
+	{
+		char path[64];
+		char *csv = (char *)malloc(0x40 + cnt * 0x40);
+		u32 pos = 0;
+
+		s_printf(csv, "session,name,depth,start_us,duration_us,complete\n");
+		pos = strlen(csv);
+		for (u32 i = 0; i < cnt; i++)
+		{
+			s_printf(csv + pos, "%d,%s,%d,%d,%d,%d\n", spans[i].session, spans[i].name,
+				spans[i].depth, spans[i].start, spans[i].duration, spans[i].done);
+			pos += strlen(csv + pos);
+		}
+
+		emmcsn_path_impl(path, "/dumps", "boot_trace.csv", NULL);
+		error = sd_save_to_file(csv, pos, path);
+
+		free(csv);
+		sd_unmount();
+	}
+	free(spans);
+
+	_create_window_dump_done(error, "boot_trace.csv");
+
+	return LV_RES_OK;
+}
+
+static lv_res_t _create_window_btrace_status(lv_obj_t *btn)
+{
+	lv_obj_t *win = nyx_create_standard_window(SYMBOL_CLOCK" Boot Trace");
+	lv_win_add_btn(win, NULL, SYMBOL_DOWNLOAD" Save CSV", _btrace_save_csv_action);
+
+	btrace_span_t *spans;
+	u32 cnt = _btrace_spans_get(&spans);
+	if (!cnt)
+	{
+		lv_obj_t *lb_desc = lv_label_create(win, NULL);
+		lv_label_set_recolor(lb_desc, true);
+		lv_label_set_static_text(lb_desc, "#FFDD00 No boot trace found!#");
+
+		return LV_RES_OK;
+	}
+
+	static lv_style_t bar_style, bar_inc_style;
+	lv_style_copy(&bar_style, &lv_style_plain);
+	bar_style.body.main_color = LV_COLOR_HEX(0x00DDFF);
+	bar_style.body.grad_color = bar_style.body.main_color;
+	bar_style.body.radius = 2;
+	lv_style_copy(&bar_inc_style, &bar_style);
+	bar_inc_style.body.main_color = LV_COLOR_HEX(0xFF8000);
+	bar_inc_style.body.grad_color = bar_inc_style.body.main_color;
+
+	const lv_coord_t row_h = lv_font_get_height(monospace_text.text.font) + LV_DPI / 20;
+	const lv_coord_t bar_x = LV_DPI * 7 / 2;
+	const lv_coord_t bar_w = LV_HOR_RES - bar_x - LV_DPI;
+
+	lv_obj_t *desc = lv_cont_create(win, NULL);
+	lv_cont_set_style(desc, &lv_style_transp);
+	lv_cont_set_layout(desc, LV_LAYOUT_OFF);
+	lv_obj_set_size(desc, LV_HOR_RES - LV_DPI / 2, (cnt * 2 + 1) * row_h);
+
+	char *txt_buf = (char *)malloc(0x100);
+	lv_coord_t y = 0;
+	u32 session = 0;
+	u32 span_total = 1;
+
+	for (u32 i = 0; i < cnt; i++)
+	{
+		btrace_span_t *span = &spans[i];
+
+		// Print session header and calculate the waterfall scale.
+		if (span->session != session)
+		{
+			session = span->session;
+			span_total = 1;
+			for (u32 j = i; j < cnt && spans[j].session == session; j++)
+				span_total = MAX(span_total, spans[j].start + spans[j].duration);
+
+			s_printf(txt_buf, "#00DDFF Session %d# - %d ms", session, span_total / 1000);
+			lv_obj_t *lb_sess = lv_label_create(desc, NULL);
+			lv_label_set_recolor(lb_sess, true);
+			lv_label_set_style(lb_sess, &monospace_text);
+			lv_label_set_text(lb_sess, txt_buf);
+			lv_obj_set_pos(lb_sess, 0, y);
+			y += row_h;
+		}
+
+		// Indent by depth and pad name.
+		u32 pos = span->depth * 2;
+		memset(txt_buf, ' ', pos + BTRACE_NAME_LEN);
+		memcpy(txt_buf + pos, span->name, strlen(span->name));
+		pos += BTRACE_NAME_LEN;
+
+		if (span->done)
+			s_printf(txt_buf + pos, "%6d.%03d ms", span->duration / 1000, span->duration % 1000);
+		else
+			s_printf(txt_buf + pos, "#FF8000 incomplete#");
+
+		lv_obj_t *lb_span = lv_label_create(desc, NULL);
+		lv_label_set_recolor(lb_span, true);
+		lv_label_set_style(lb_span, &monospace_text);
+		lv_label_set_text(lb_span, txt_buf);
+		lv_obj_set_pos(lb_span, LV_DPI / 8, y);
+
+		// Draw the waterfall bar. Incomplete spans extend to the end of the session.
+		u32 duration = span->done ? span->duration : (span_total - MIN(span_total, span->start));
+		lv_obj_t *bar = lv_obj_create(desc, NULL);
+		lv_obj_set_style(bar, span->done ? &bar_style : &bar_inc_style);
+		lv_obj_set_click(bar, false);
+		lv_obj_set_size(bar, MAX(2, (u64)duration * bar_w / span_total), row_h - LV_DPI / 20);
+		lv_obj_set_pos(bar, bar_x + (u64)span->start * bar_w / span_total, y + LV_DPI / 40);
+
+		y += row_h;
+	}
+
+	lv_obj_set_height(desc, y);
+
+	free(txt_buf);
+	free(spans);
+
+	return LV_RES_OK;
+}
+
 void create_tab_info(lv_theme_t *th, lv_obj_t *parent)
 {
 	lv_page_set_scrl_layout(parent, LV_LAYOUT_PRETTY);
@@ -2335,11 +2628,19 @@ void create_tab_info(lv_theme_t *th, lv_obj_t *parent)
 	lv_obj_align(btn7, line_sep, LV_ALIGN_OUT_BOTTOM_LEFT, LV_DPI / 4, LV_DPI / 2);
 	lv_btn_set_action(btn7, LV_BTN_ACTION_CLICK, _create_window_battery_status);
 
+	// Create Boot Trace button.
+	lv_obj_t *btn8 = lv_btn_create(h2, btn);
+	label_btn = lv_label_create(btn8, NULL);
+	lv_label_set_static_text(label_btn, SYMBOL_CLOCK"  Boot Trace");
+	lv_obj_align(btn8, btn7, LV_ALIGN_OUT_RIGHT_TOP, LV_DPI * 3 / 4, 0);
+	lv_btn_set_action(btn8, LV_BTN_ACTION_CLICK, _create_window_btrace_status);
+
 	lv_obj_t *label_txt6 = lv_label_create(h2, NULL);
 	lv_label_set_recolor(label_txt6, true);
 	lv_label_set_static_text(label_txt6,
 		"View battery and battery charger related info.\n"
-		"Additionally you can dump battery charger's registers.\n");
+		"Additionally you can dump battery charger's registers.\n"
+		"Or view the #C7EA46 Boot Trace# timings and save them as CSV.");
 	lv_obj_set_style(label_txt6, &hint_small_style);
 	lv_obj_align(label_txt6, btn7, LV_ALIGN_OUT_BOTTOM_LEFT, 0, LV_DPI / 3);
 }
@@ -204,24 +204,11 @@ static lv_res_t _create_mbox_hid(usb_ctxt_t *usbs)
 	return LV_RES_OK;
 }
 
-static lv_res_t _create_mbox_ums(usb_ctxt_t *usbs)
+static void _ums_lun_name(char *txt_buf, u32 type, u32 partition)
 {
-	lv_obj_t *dark_bg = lv_obj_create(lv_scr_act(), NULL);
-	lv_obj_set_style(dark_bg, &mbox_darken);
-	lv_obj_set_size(dark_bg, LV_HOR_RES, LV_VER_RES);
-
-	static const char *mbox_btn_map[] = { "\211", "\262Close", "\211", "" };
-	static const char *mbox_btn_map2[] = { "\211", "\222Close", "\211", "" };
-	lv_obj_t *mbox = lv_mbox_create(dark_bg, NULL);
-	lv_mbox_set_recolor_text(mbox, true);
-
-	char *txt_buf = malloc(0x1000);
-
-	s_printf(txt_buf, "#FF8000 USB Mass Storage#\n\n#C7EA46 Device:# ");
-
-	if (usbs->type == MMC_SD)
+	if (type == MMC_SD)
 	{
-		switch (usbs->partition)
+		switch (partition)
 		{
 		case 0:
 			strcat(txt_buf, "SD Card");
@@ -239,7 +226,7 @@ static lv_res_t _create_mbox_ums(usb_ctxt_t *usbs)
 	}
 	else
 	{
-		switch (usbs->partition)
+		switch (partition)
 		{
 		case EMMC_GPP + 1:
 			strcat(txt_buf, "eMMC GPP");
@@ -252,6 +239,29 @@ static lv_res_t _create_mbox_ums(usb_ctxt_t *usbs)
 			break;
 		}
 	}
+}
+
+static lv_res_t _create_mbox_ums(usb_ctxt_t *usbs)
+{
+	lv_obj_t *dark_bg = lv_obj_create(lv_scr_act(), NULL);
+	lv_obj_set_style(dark_bg, &mbox_darken);
+	lv_obj_set_size(dark_bg, LV_HOR_RES, LV_VER_RES);
+
+	static const char *mbox_btn_map[] = { "\211", "\262Close", "\211", "" };
+	static const char *mbox_btn_map2[] = { "\211", "\222Close", "\211", "" };
+	lv_obj_t *mbox = lv_mbox_create(dark_bg, NULL);
+	lv_mbox_set_recolor_text(mbox, true);
+
+	char *txt_buf = malloc(0x1000);
+
+	s_printf(txt_buf, "#FF8000 USB Mass Storage#\n\n#C7EA46 Device:# ");
+
+	_ums_lun_name(txt_buf, usbs->type, usbs->partition);
+	for (u32 i = 0; i < usbs->ext_luns; i++)
+	{
+		strcat(txt_buf, ", ");
+		_ums_lun_name(txt_buf, usbs->ext_lun[i].type, usbs->ext_lun[i].partition);
+	}
 
 	lv_mbox_set_text(mbox, txt_buf);
 	free(txt_buf);
@@ -294,6 +304,7 @@ static lv_res_t _create_mbox_ums(usb_ctxt_t *usbs)
 	// Dim backlight.
 	display_backlight_brightness(20, 1000);
 
+	usbs->cache_size = n_cfg.ums_cache;
 	usb_device_gadget_ums(usbs);
 
 	// Restore backlight.
@@ -400,6 +411,7 @@ lv_res_t action_ums_sd(lv_obj_t *btn)
 	usbs.offset = 0;
 	usbs.sectors = 0;
 	usbs.ro = 0;
+	usbs.ext_luns = 0;
 	usbs.system_maintenance = &manual_system_maintenance;
 	usbs.set_text = &usb_gadget_set_text;
 
@@ -419,6 +431,7 @@ static lv_res_t _action_ums_emmc_boot0(lv_obj_t *btn)
 	usbs.offset = 0;
 	usbs.sectors = 0x2000;
 	usbs.ro = usb_msc_emmc_read_only;
+	usbs.ext_luns = 0;
 	usbs.system_maintenance = &manual_system_maintenance;
 	usbs.set_text = &usb_gadget_set_text;
 
@@ -438,6 +451,7 @@ static lv_res_t _action_ums_emmc_boot1(lv_obj_t *btn)
 	usbs.offset = 0;
 	usbs.sectors = 0x2000;
 	usbs.ro = usb_msc_emmc_read_only;
+	usbs.ext_luns = 0;
 	usbs.system_maintenance = &manual_system_maintenance;
 	usbs.set_text = &usb_gadget_set_text;
 
@@ -457,6 +471,39 @@ static lv_res_t _action_ums_emmc_gpp(lv_obj_t *btn)
 	usbs.offset = 0;
 	usbs.sectors = 0;
 	usbs.ro = usb_msc_emmc_read_only;
+	usbs.ext_luns = 0;
+	usbs.system_maintenance = &manual_system_maintenance;
+	usbs.set_text = &usb_gadget_set_text;
+
+	_create_mbox_ums(&usbs);
+
+	return LV_RES_OK;
+}
+
+static lv_res_t _action_ums_sd_emmc(lv_obj_t *btn)
+{
+	if (!nyx_emmc_check_battery_enough())
+		return LV_RES_OK;
+
+	usb_ctxt_t usbs;
+	usbs.type = MMC_SD;
+	usbs.partition = 0;
+	usbs.offset = 0;
+	usbs.sectors = 0;
+	usbs.ro = 0;
+
+	// Expose eMMC partitions as extra LUNs.
+	static const u32 emmc_parts[] = { EMMC_GPP + 1, EMMC_BOOT0 + 1, EMMC_BOOT1 + 1 };
+	usbs.ext_luns = ARRAY_SIZE(emmc_parts);
+	for (u32 i = 0; i < usbs.ext_luns; i++)
+	{
+		usbs.ext_lun[i].type = MMC_EMMC;
+		usbs.ext_lun[i].partition = emmc_parts[i];
+		usbs.ext_lun[i].offset = 0;
+		usbs.ext_lun[i].sectors = (emmc_parts[i] == EMMC_GPP + 1) ? 0 : 0x2000;
+		usbs.ext_lun[i].ro = usb_msc_emmc_read_only;
+	}
+
 	usbs.system_maintenance = &manual_system_maintenance;
 	usbs.set_text = &usb_gadget_set_text;
 
@@ -499,6 +546,7 @@ static lv_res_t _action_ums_emuemmc_boot0(lv_obj_t *btn)
 		usbs.partition = EMMC_BOOT0 + 1;
 		usbs.sectors = 0x2000;
 		usbs.ro = usb_msc_emmc_read_only;
+		usbs.ext_luns = 0;
 		usbs.system_maintenance = &manual_system_maintenance;
 		usbs.set_text = &usb_gadget_set_text;
 		_create_mbox_ums(&usbs);
@@ -541,6 +589,7 @@ static lv_res_t _action_ums_emuemmc_boot1(lv_obj_t *btn)
 		usbs.partition = EMMC_BOOT1 + 1;
 		usbs.sectors = 0x2000;
 		usbs.ro = usb_msc_emmc_read_only;
+		usbs.ext_luns = 0;
 		usbs.system_maintenance = &manual_system_maintenance;
 		usbs.set_text = &usb_gadget_set_text;
 		_create_mbox_ums(&usbs);
@@ -592,6 +641,7 @@ static lv_res_t _action_ums_emuemmc_gpp(lv_obj_t *btn)
 		usbs.type = MMC_SD;
 		usbs.partition = EMMC_GPP + 1;
 		usbs.ro = usb_msc_emmc_read_only;
+		usbs.ext_luns = 0;
 		usbs.system_maintenance = &manual_system_maintenance;
 		usbs.set_text = &usb_gadget_set_text;
 		_create_mbox_ums(&usbs);
@@ -686,6 +736,13 @@ static lv_res_t _create_window_usb_tools(lv_obj_t *parent)
 	lv_obj_align(btn1, line_sep, LV_ALIGN_OUT_BOTTOM_LEFT, LV_DPI / 4, LV_DPI / 4);
 	lv_btn_set_action(btn1, LV_BTN_ACTION_CLICK, action_ums_sd);
 
+	// Create SD + eMMC multi LUN button.
+	lv_obj_t *btn_multi = lv_btn_create(h1, btn1);
+	label_btn = lv_label_create(btn_multi, NULL);
+	lv_label_set_static_text(label_btn, SYMBOL_SD" + "SYMBOL_CHIP"  SD & eMMC");
+	lv_obj_align(btn_multi, btn1, LV_ALIGN_OUT_RIGHT_MID, LV_DPI / 10, 0);
+	lv_btn_set_action(btn_multi, LV_BTN_ACTION_CLICK, _action_ums_sd_emmc);
+
 	lv_obj_t *label_txt2 = lv_label_create(h1, NULL);
 	lv_label_set_recolor(label_txt2, true);
 	lv_label_set_static_text(label_txt2,
@@ -516,3 +516,11 @@ void __attribute__((optimize("unroll-loops"))) gfx_set_rect_land_block(u32 *fb,
 	// 	}
 	// }
 }
+
+void gfx_copy_rect_land_pitch(u32 *fb_dst, const u32 *fb_src, u32 stride, u32 pos_x, u32 pos_y, u32 pos_x2, u32 pos_y2)
+{
+	// Landscape columns are framebuffer lines, so copy them whole.
+	u32 size = (pos_y2 - pos_y + 1) * sizeof(u32);
+	for (u32 x = pos_x; x < (pos_x2 + 1); x++)
+		memcpy(&fb_dst[x * stride + pos_y], &fb_src[x * stride + pos_y], size);
+}
@@ -68,5 +68,6 @@ void gfx_set_pixel(u32 x, u32 y, u32 color);
 
 void gfx_set_rect_land_pitch(u32 *fb, const u32 *buf, u32 stride, u32 pos_x, u32 pos_y, u32 pos_x2, u32 pos_y2);
 void gfx_set_rect_land_block(u32 *fb, const u32 *buf, u32 pos_x, u32 pos_y, u32 pos_x2, u32 pos_y2);
+void gfx_copy_rect_land_pitch(u32 *fb_dst, const u32 *fb_src, u32 stride, u32 pos_x, u32 pos_y, u32 pos_x2, u32 pos_y2);
 
 #endif
@@ -288,8 +288,12 @@ void load_saved_configuration()
 						n_cfg.home_screen = atoi(kv->val);
 					else if (!strcmp("verification", kv->key))
 						n_cfg.verification = atoi(kv->val);
+					else if (!strcmp("sparsebackup", kv->key))
+						n_cfg.sparse_backup = atoi(kv->val) == 1;
 					else if (!strcmp("umsemmcrw", kv->key))
 						n_cfg.ums_emmc_rw = atoi(kv->val) == 1;
+					else if (!strcmp("umscache", kv->key))
+						n_cfg.ums_cache = atoi(kv->val);
 					else if (!strcmp("jcdisable", kv->key))
 						n_cfg.jc_disable = atoi(kv->val) == 1;
 					else if (!strcmp("newpowersave", kv->key))
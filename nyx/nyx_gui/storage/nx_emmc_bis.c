@@ -17,6 +17,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
 #include <string.h>
 
 #include <memory_map.h>
@@ -25,6 +26,7 @@
 #include <sec/se.h>
 #include <sec/se_t210.h>
 #include "../storage/nx_emmc.h"
+#include "../storage/nx_emmc_bis.h"
 #include <storage/nx_sd.h>
 #include <storage/sdmmc.h>
 #include <utils/types.h>
@@ -32,28 +34,38 @@
 #define BIS_CLUSTER_SECTORS   32
 #define BIS_CLUSTER_SIZE      16384
 #define BIS_CACHE_MAX_ENTRIES 16384
+#define BIS_CACHE_RUN_CLUSTERS 16 // Max clusters per coalesced write-back.
 #define BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY -1
 
 typedef struct _cluster_cache_t
 {
 	u32  cluster_idx;            // Index of the cluster in the partition.
-	bool dirty;                  // Has been modified without write-back flag.
-	u8   data[BIS_CLUSTER_SIZE]; // The cached cluster itself. Aligned to 8 bytes for DMA engine.
+	u8   dirty;                  // Has been modified without write-back flag.
+	u8   visited;                // Accessed since last clock sweep flag.
+	u8   rsvd[2];
+	u8   data[BIS_CLUSTER_SIZE] __attribute__((aligned(8))); // The cached cluster itself. Aligned to 8 bytes for DMA engine.
 } cluster_cache_t;
 
 typedef struct _bis_cache_t
 {
-	bool full;
 	bool enabled;
 	u32  dirty_cnt;
 	u32  top_idx;
-	u8   dma_buff[BIS_CLUSTER_SIZE]; // Aligned to 8 bytes for DMA engine.
+	u32  clock_idx;
+	nx_emmc_bis_stats_t stats;
+	u8   tweaks[SE_KEY_128_SIZE * BIS_CACHE_RUN_CLUSTERS] __attribute__((aligned(8)));  // Cluster tweaks of a batched read.
+	u8   tweak_tbl[2][BIS_CLUSTER_SIZE] __attribute__((aligned(8)));                      // Expanded block tweaks of in-flight clusters.
+	u8   dma_buff[BIS_CLUSTER_SIZE * BIS_CACHE_RUN_CLUSTERS] __attribute__((aligned(8))); // Aligned to 8 bytes for DMA engine.
 	cluster_cache_t clusters[];
 } bis_cache_t;
 
+static_assert(sizeof(bis_cache_t) + sizeof(cluster_cache_t) * BIS_CACHE_MAX_ENTRIES <= NX_BIS_CACHE_SZ,
+	"BIS cache does not fit in its reserved space!");
+
 static u8  ks_crypt = 0;
 static u8  ks_tweak = 0;
 static u32 emu_offset = 0;
+static u32 part_clusters = 0;
 static emmc_part_t *system_part = NULL;
 static u32 *cache_lookup_tbl = (u32 *)NX_BIS_LOOKUP_ADDR;
 static bis_cache_t *bis_cache = (bis_cache_t *)NX_BIS_CACHE_ADDR;
@@ -126,64 +138,92 @@ static int _nx_aes_xts_crypt_sec(u32 tweak_ks, u32 crypt_ks, u32 enc, u8 *tweak,
 	return 1;
 }
 
-static int nx_emmc_bis_write_block(u32 sector, u32 count, void *buff, bool flush)
+static int _nx_emmc_bis_raw_write(u32 sector, u32 count, void *buff)
+{
+	if (!emu_offset)
+		return nx_emmc_part_write(&emmc_storage, system_part, sector, count, buff);
+	else
+		return sdmmc_storage_write(&sd_storage, emu_offset + system_part->lba_start + sector, count, buff);
+}
+
+static int _nx_emmc_bis_raw_read(u32 sector, u32 count, void *buff)
+{
+	if (!emu_offset)
+		return nx_emmc_part_read(&emmc_storage, system_part, sector, count, buff);
+	else
+		return sdmmc_storage_read(&sd_storage, emu_offset + system_part->lba_start + sector, count, buff);
+}
+
+static int _nx_emmc_bis_cache_write_back(u32 cluster)
+{
+	u8  tweak[SE_KEY_128_SIZE] __attribute__((aligned(4)));
+	u32 run_cnt = 0;
+
+	// Coalesce the following dirty cached clusters into one write.
+	while (run_cnt < BIS_CACHE_RUN_CLUSTERS && (cluster + run_cnt) < part_clusters)
+	{
+		u32 lookup_idx = cache_lookup_tbl[cluster + run_cnt];
+		if (lookup_idx == BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY || !bis_cache->clusters[lookup_idx].dirty)
+			break;
+
+		// Encrypt cluster.
+		if (!_nx_aes_xts_crypt_sec(ks_tweak, ks_crypt, 1, tweak, true, 0, cluster + run_cnt,
+			bis_cache->dma_buff + run_cnt * BIS_CLUSTER_SIZE, bis_cache->clusters[lookup_idx].data, BIS_CLUSTER_SIZE))
+			return 1; // Encryption error.
+
+		run_cnt++;
+	}
+
+	if (!_nx_emmc_bis_raw_write(cluster * BIS_CLUSTER_SECTORS, run_cnt * BIS_CLUSTER_SECTORS, bis_cache->dma_buff))
+		return 1; // R/W error.
+
+	// Mark cache entries not dirty since write succeeded.
+	for (u32 i = 0; i < run_cnt; i++)
+		bis_cache->clusters[cache_lookup_tbl[cluster + i]].dirty = false;
+	bis_cache->dirty_cnt -= run_cnt;
+	bis_cache->stats.writebacks += run_cnt;
+
+	return 0; // Success.
+}
+
+static int nx_emmc_bis_write_block(u32 sector, u32 count, void *buff)
 {
 	if (!system_part)
 		return 3; // Not ready.
 
-	int res;
 	u8   tweak[SE_KEY_128_SIZE] __attribute__((aligned(4)));
 	u32  cluster = sector / BIS_CLUSTER_SECTORS;
-	u32  aligned_sector = cluster * BIS_CLUSTER_SECTORS;
 	u32  sector_in_cluster = sector % BIS_CLUSTER_SECTORS;
 	u32  lookup_idx = cache_lookup_tbl[cluster];
-	bool is_cached = lookup_idx != BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY;
 
 	// Write to cached cluster.
-	if (is_cached)
+	if (bis_cache->enabled && lookup_idx != BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY)
 	{
-		if (buff)
-			memcpy(bis_cache->clusters[lookup_idx].data + sector_in_cluster * NX_EMMC_BLOCKSIZE, buff, count * NX_EMMC_BLOCKSIZE);
-		else
-			buff = bis_cache->clusters[lookup_idx].data;
-		if (!bis_cache->clusters[lookup_idx].dirty)
-			bis_cache->dirty_cnt++;
-		bis_cache->clusters[lookup_idx].dirty = true;
+		cluster_cache_t *entry = &bis_cache->clusters[lookup_idx];
 
-		if (!flush)
-			return 0; // Success.
+		memcpy(entry->data + sector_in_cluster * NX_EMMC_BLOCKSIZE, buff, count * NX_EMMC_BLOCKSIZE);
+		if (!entry->dirty)
+			bis_cache->dirty_cnt++;
+		entry->dirty = true;
+		entry->visited = true;
 
-		// Reset args to trigger a full cluster flush to emmc.
-		sector_in_cluster = 0;
-		sector = aligned_sector;
-		count = BIS_CLUSTER_SECTORS;
+		return 0; // Success.
 	}
 
 	// Encrypt cluster.
 	if (!_nx_aes_xts_crypt_sec(ks_tweak, ks_crypt, 1, tweak, true, sector_in_cluster, cluster, bis_cache->dma_buff, buff, count * NX_EMMC_BLOCKSIZE))
 		return 1; // Encryption error.
 
-	// If not reading from cache, do a regular read and decrypt.
-	if (!emu_offset)
-		res = nx_emmc_part_write(&emmc_storage, system_part, sector, count, bis_cache->dma_buff);
-	else
-		res = sdmmc_storage_write(&sd_storage, emu_offset + system_part->lba_start + sector, count, bis_cache->dma_buff);
-	if (!res)
+	// If not writing to cache, do a regular encrypt and write.
+	if (!_nx_emmc_bis_raw_write(sector, count, bis_cache->dma_buff))
 		return 1; // R/W error.
 
-	// Mark cache entry not dirty if write succeeds.
-	if (is_cached)
-	{
-		bis_cache->clusters[lookup_idx].dirty = false;
-		bis_cache->dirty_cnt--;
-	}
-
 	return 0; // Success.
 }
 
 static void _nx_emmc_bis_cluster_cache_init(bool enable_cache)
 {
-	u32 cache_lookup_tbl_size = (system_part->lba_end - system_part->lba_start + 1) / BIS_CLUSTER_SECTORS * sizeof(*cache_lookup_tbl);
+	u32 cache_lookup_tbl_size = part_clusters * sizeof(*cache_lookup_tbl);
 
 	// Clear cache header.
 	memset(bis_cache, 0, sizeof(bis_cache_t));
@@ -200,15 +240,50 @@ static void _nx_emmc_bis_flush_cache()
 	if (!bis_cache->enabled || !bis_cache->dirty_cnt)
 		return;
 
-	for (u32 i = 0; i < bis_cache->top_idx && bis_cache->dirty_cnt; i++)
+	// Walk the lookup table so that write-back is done in sorted and coalesced runs.
+	for (u32 cluster = 0; cluster < part_clusters && bis_cache->dirty_cnt; cluster++)
 	{
-		if (bis_cache->clusters[i].dirty) {
-			nx_emmc_bis_write_block(bis_cache->clusters[i].cluster_idx * BIS_CLUSTER_SECTORS, BIS_CLUSTER_SECTORS, NULL, true);
-			bis_cache->dirty_cnt--;
+		u32 lookup_idx = cache_lookup_tbl[cluster];
+		if (lookup_idx != BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY && bis_cache->clusters[lookup_idx].dirty)
+		{
+			if (_nx_emmc_bis_cache_write_back(cluster))
+				break;
 		}
 	}
+}
 
-	_nx_emmc_bis_cluster_cache_init(true);
+static u32 _nx_emmc_bis_cache_get_entry()
+{
+	// Use a never used entry if cache is not full.
+	if (bis_cache->top_idx < BIS_CACHE_MAX_ENTRIES)
+		return bis_cache->top_idx++;
+
+	// Evict a single entry with CLOCK policy. Recently accessed ones get a second chance.
+	while (true)
+	{
+		u32 idx = bis_cache->clock_idx;
+		cluster_cache_t *entry = &bis_cache->clusters[idx];
+
+		bis_cache->clock_idx = (idx + 1) % BIS_CACHE_MAX_ENTRIES;
+
+		if (entry->visited)
+		{
+			entry->visited = false;
+			continue;
+		}
+
+		if (entry->cluster_idx != BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY)
+		{
+			if (entry->dirty && _nx_emmc_bis_cache_write_back(entry->cluster_idx))
+				return BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY; // R/W error.
+
+			cache_lookup_tbl[entry->cluster_idx] = BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY;
+			entry->cluster_idx = BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY;
+			bis_cache->stats.evictions++;
+		}
+
+		return idx;
+	}
 }
 
 static int nx_emmc_bis_read_block_normal(u32 sector, u32 count, void *buff)
@@ -217,18 +292,13 @@ static int nx_emmc_bis_read_block_normal(u32 sector, u32 count, void *buff)
 	static u32 prev_sector = 0;
 	static u8  tweak[SE_KEY_128_SIZE] __attribute__((aligned(4)));
 
-	int  res;
 	bool regen_tweak = true;
 	u32  tweak_exp = 0;
 	u32  cluster = sector / BIS_CLUSTER_SECTORS;
 	u32  sector_in_cluster = sector % BIS_CLUSTER_SECTORS;
 
 	// If not reading from cache, do a regular read and decrypt.
-	if (!emu_offset)
-		res = nx_emmc_part_read(&emmc_storage, system_part, sector, count, bis_cache->dma_buff);
-	else
-		res = sdmmc_storage_read(&sd_storage, emu_offset + system_part->lba_start + sector, count, bis_cache->dma_buff);
-	if (!res)
+	if (!_nx_emmc_bis_raw_read(sector, count, bis_cache->dma_buff))
 		return 1; // R/W error.
 
 	if (prev_cluster != cluster) // Sector in different cluster than last read.
@@ -256,7 +326,6 @@ static int nx_emmc_bis_read_block_normal(u32 sector, u32 count, void *buff)
 
 static int nx_emmc_bis_read_block_cached(u32 sector, u32 count, void *buff)
 {
-	int res;
 	u8  cache_tweak[SE_KEY_128_SIZE] __attribute__((aligned(4)));
 	u32 cluster = sector / BIS_CLUSTER_SECTORS;
 	u32 cluster_sector = cluster * BIS_CLUSTER_SECTORS;
@@ -266,38 +335,158 @@ static int nx_emmc_bis_read_block_cached(u32 sector, u32 count, void *buff)
 	// Read from cached cluster.
 	if (lookup_idx != BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY)
 	{
+		bis_cache->clusters[lookup_idx].visited = true;
 		memcpy(buff, bis_cache->clusters[lookup_idx].data + sector_in_cluster * NX_EMMC_BLOCKSIZE, count * NX_EMMC_BLOCKSIZE);
+		bis_cache->stats.hits++;
 
 		return 0; // Success.
 	}
 
-	// Flush cache if full.
-	if (bis_cache->top_idx >= BIS_CACHE_MAX_ENTRIES)
-		_nx_emmc_bis_flush_cache();
+	bis_cache->stats.misses++;
 
-	// Set new cached cluster parameters.
-	bis_cache->clusters[bis_cache->top_idx].cluster_idx = cluster;
-	bis_cache->clusters[bis_cache->top_idx].dirty = false;
-	cache_lookup_tbl[cluster] = bis_cache->top_idx;
+	// Get a free entry or evict one if full.
+	lookup_idx = _nx_emmc_bis_cache_get_entry();
+	if (lookup_idx == BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY)
+		return 1; // R/W error.
+
+	cluster_cache_t *entry = &bis_cache->clusters[lookup_idx];
+	entry->cluster_idx = BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY;
 
 	// Read the whole cluster the sector resides in.
-	if (!emu_offset)
-		res = nx_emmc_part_read(&emmc_storage, system_part, cluster_sector, BIS_CLUSTER_SECTORS, bis_cache->dma_buff);
-	else
-		res = sdmmc_storage_read(&sd_storage, emu_offset + system_part->lba_start + cluster_sector, BIS_CLUSTER_SECTORS, bis_cache->dma_buff);
-	if (!res)
+	if (!_nx_emmc_bis_raw_read(cluster_sector, BIS_CLUSTER_SECTORS, entry->data))
 		return 1; // R/W error.
 
 	// Decrypt cluster.
-	if (!_nx_aes_xts_crypt_sec(ks_tweak, ks_crypt, 0, cache_tweak, true, 0, cluster, bis_cache->dma_buff, bis_cache->dma_buff, BIS_CLUSTER_SIZE))
+	if (!_nx_aes_xts_crypt_sec(ks_tweak, ks_crypt, 0, cache_tweak, true, 0, cluster, entry->data, entry->data, BIS_CLUSTER_SIZE))
+		return 1; // Decryption error.
+
+	// Set new cached cluster parameters.
+	entry->cluster_idx = cluster;
+	entry->dirty = false;
+	entry->visited = false;
+	cache_lookup_tbl[cluster] = lookup_idx;
+
+	memcpy(buff, entry->data + sector_in_cluster * NX_EMMC_BLOCKSIZE, count * NX_EMMC_BLOCKSIZE);
+
+	return 0; // Success.
+}
+
+static void _nx_emmc_bis_xts_pre_xor(u8 *tweak, u32 *tweak_tbl, u32 *data)
+{
+	u32 *ptweak = (u32 *)tweak;
+
+	// Expand the tweak for each block once and keep it for the post XOR.
+	for (u32 i = 0; i < (BIS_CLUSTER_SIZE >> 4); i++)
+	{
+		for (u32 j = 0; j < 4; j++)
+		{
+			tweak_tbl[j] = ptweak[j];
+			data[j] ^= ptweak[j];
+		}
+
+		_gf256_mul_x_le(tweak);
+		tweak_tbl += 4;
+		data += 4;
+	}
+}
+
+static void _nx_emmc_bis_xts_post_xor(u32 *tweak_tbl, u32 *data)
+{
+	for (u32 i = 0; i < (BIS_CLUSTER_SIZE >> 2); i++)
+		data[i] ^= tweak_tbl[i];
+}
+
+static int _nx_emmc_bis_read_clusters(u32 cluster, u32 cluster_cnt, u8 *buf)
+{
+	// Read all contiguous clusters with one command. Buffer must be aligned to 8 bytes.
+	if (!_nx_emmc_bis_raw_read(cluster * BIS_CLUSTER_SECTORS, cluster_cnt * BIS_CLUSTER_SECTORS, buf))
+		return 1; // R/W error.
+
+	// Generate all cluster tweaks with one SE operation.
+	memset(bis_cache->tweaks, 0, SE_KEY_128_SIZE * cluster_cnt);
+	for (u32 i = 0; i < cluster_cnt; i++)
+	{
+		u32 sec = cluster + i;
+		u8 *tweak = bis_cache->tweaks + i * SE_KEY_128_SIZE;
+		tweak[0xC] = sec >> 24;
+		tweak[0xD] = (sec >> 16) & 0xFF;
+		tweak[0xE] = (sec >> 8) & 0xFF;
+		tweak[0xF] = sec & 0xFF;
+	}
+	if (!se_aes_crypt_ecb(ks_tweak, 1, bis_cache->tweaks, SE_KEY_128_SIZE * cluster_cnt, bis_cache->tweaks, SE_KEY_128_SIZE * cluster_cnt))
 		return 1; // Decryption error.
 
-	// Copy to cluster cache.
-	memcpy(bis_cache->clusters[bis_cache->top_idx].data, bis_cache->dma_buff, BIS_CLUSTER_SIZE);
-	memcpy(buff, bis_cache->dma_buff + sector_in_cluster * NX_EMMC_BLOCKSIZE, count * NX_EMMC_BLOCKSIZE);
+	// Pipeline XTS. Pre XOR the next cluster while SE decrypts the current one.
+	_nx_emmc_bis_xts_pre_xor(bis_cache->tweaks, (u32 *)bis_cache->tweak_tbl[0], (u32 *)buf);
+	for (u32 i = 0; i < cluster_cnt; i++)
+	{
+		u8 *data = buf + i * BIS_CLUSTER_SIZE;
+
+		if (!se_aes_crypt_ecb_async(ks_crypt, 0, data, BIS_CLUSTER_SIZE, data, BIS_CLUSTER_SIZE))
+			return 1; // Decryption error.
+
+		if ((i + 1) < cluster_cnt)
+			_nx_emmc_bis_xts_pre_xor(bis_cache->tweaks + (i + 1) * SE_KEY_128_SIZE,
+				(u32 *)bis_cache->tweak_tbl[(i + 1) & 1], (u32 *)(data + BIS_CLUSTER_SIZE));
+
+		if (!se_aes_crypt_finalize())
+			return 1; // Decryption error.
+
+		_nx_emmc_bis_xts_post_xor((u32 *)bis_cache->tweak_tbl[i & 1], (u32 *)data);
+	}
+
+	return 0; // Success.
+}
+
+static int nx_emmc_bis_read_clusters_normal(u32 cluster, u32 cluster_cnt, void *buff)
+{
+	// Decrypt in place if buffer is DMA aligned.
+	if (!((u32)buff & 7))
+		return _nx_emmc_bis_read_clusters(cluster, cluster_cnt, (u8 *)buff);
+
+	// Otherwise use the aligned DMA buffer and copy out.
+	if (_nx_emmc_bis_read_clusters(cluster, cluster_cnt, bis_cache->dma_buff))
+		return 1; // R/W error.
+
+	memcpy(buff, bis_cache->dma_buff, cluster_cnt * BIS_CLUSTER_SIZE);
+
+	return 0; // Success.
+}
+
+static int nx_emmc_bis_read_clusters_cached(u32 cluster, u32 cluster_cnt, void *buff)
+{
+	u32 entries[BIS_CACHE_RUN_CLUSTERS];
+
+	// Reserve all entries first, since evicting a dirty one writes back through the DMA buffer.
+	for (u32 i = 0; i < cluster_cnt; i++)
+	{
+		entries[i] = _nx_emmc_bis_cache_get_entry();
+		if (entries[i] == BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY)
+			return 1; // R/W error.
+
+		// Mark as visited so that the clock does not hand it out again for this run.
+		bis_cache->clusters[entries[i]].cluster_idx = BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY;
+		bis_cache->clusters[entries[i]].visited = true;
+	}
 
-	// Increment cache count.
-	bis_cache->top_idx++;
+	bis_cache->stats.misses += cluster_cnt;
+
+	if (_nx_emmc_bis_read_clusters(cluster, cluster_cnt, bis_cache->dma_buff))
+		return 1; // R/W error.
+
+	// Set new cached clusters.
+	for (u32 i = 0; i < cluster_cnt; i++)
+	{
+		cluster_cache_t *entry = &bis_cache->clusters[entries[i]];
+
+		memcpy(entry->data, bis_cache->dma_buff + i * BIS_CLUSTER_SIZE, BIS_CLUSTER_SIZE);
+		entry->cluster_idx = cluster + i;
+		entry->dirty = false;
+		entry->visited = false;
+		cache_lookup_tbl[cluster + i] = entries[i];
+	}
+
+	memcpy(buff, bis_cache->dma_buff, cluster_cnt * BIS_CLUSTER_SIZE);
 
 	return 0; // Success.
 }
@@ -313,6 +502,26 @@ static int nx_emmc_bis_read_block(u32 sector, u32 count, void *buff)
 		return nx_emmc_bis_read_block_normal(sector, count, buff);
 }
 
+static u32 _nx_emmc_bis_read_batch_count(u32 sector, u32 count)
+{
+	if (!system_part || (sector % BIS_CLUSTER_SECTORS) || count < BIS_CLUSTER_SECTORS)
+		return 0;
+
+	u32 cluster = sector / BIS_CLUSTER_SECTORS;
+	u32 cluster_cnt = MIN(count / BIS_CLUSTER_SECTORS, BIS_CACHE_RUN_CLUSTERS);
+
+	if (!bis_cache->enabled)
+		return cluster_cnt;
+
+	// Batch only the run of clusters that are not cached.
+	u32 miss_cnt = 0;
+	while (miss_cnt < cluster_cnt && (cluster + miss_cnt) < part_clusters &&
+		   cache_lookup_tbl[cluster + miss_cnt] == BIS_CACHE_LOOKUP_TBL_EMPTY_ENTRY)
+		miss_cnt++;
+
+	return miss_cnt;
+}
+
 int nx_emmc_bis_read(u32 sector, u32 count, void *buff)
 {
 	u8 *buf = (u8 *)buff;
@@ -320,9 +529,30 @@ int nx_emmc_bis_read(u32 sector, u32 count, void *buff)
 
 	while (count)
 	{
-		u32 sct_cnt = MIN(count, BIS_CLUSTER_SECTORS);
-		if (nx_emmc_bis_read_block(curr_sct, sct_cnt, buf))
-			return 0;
+		u32 sct_cnt;
+		u32 cluster_cnt = _nx_emmc_bis_read_batch_count(curr_sct, count);
+
+		// Batch aligned whole clusters that need to be read from storage.
+		if (cluster_cnt)
+		{
+			int res;
+			u32 cluster = curr_sct / BIS_CLUSTER_SECTORS;
+
+			sct_cnt = cluster_cnt * BIS_CLUSTER_SECTORS;
+			if (bis_cache->enabled)
+				res = nx_emmc_bis_read_clusters_cached(cluster, cluster_cnt, buf);
+			else
+				res = nx_emmc_bis_read_clusters_normal(cluster, cluster_cnt, buf);
+
+			if (res)
+				return 0;
+		}
+		else
+		{
+			sct_cnt = MIN(count, BIS_CLUSTER_SECTORS - (curr_sct % BIS_CLUSTER_SECTORS));
+			if (nx_emmc_bis_read_block(curr_sct, sct_cnt, buf))
+				return 0;
+		}
 
 		count    -= sct_cnt;
 		curr_sct += sct_cnt;
@@ -340,7 +570,7 @@ int nx_emmc_bis_write(u32 sector, u32 count, void *buff)
 	while (count)
 	{
 		u32 sct_cnt = MIN(count, BIS_CLUSTER_SECTORS);
-		if (nx_emmc_bis_write_block(curr_sct, sct_cnt, buf, false))
+		if (nx_emmc_bis_write_block(curr_sct, sct_cnt, buf))
 			return 0;
 
 		count    -= sct_cnt;
@@ -355,6 +585,7 @@ void nx_emmc_bis_init(emmc_part_t *part, bool enable_cache, u32 emummc_offset)
 {
 	system_part = part;
 	emu_offset = emummc_offset;
+	part_clusters = (part->lba_end - part->lba_start + 1) / BIS_CLUSTER_SECTORS;
 
 	_nx_emmc_bis_cluster_cache_init(enable_cache);
 
@@ -377,6 +608,11 @@ void nx_emmc_bis_init(emmc_part_t *part, bool enable_cache, u32 emummc_offset)
 		system_part = NULL;
 }
 
+void nx_emmc_bis_get_stats(nx_emmc_bis_stats_t *stats)
+{
+	memcpy(stats, &bis_cache->stats, sizeof(nx_emmc_bis_stats_t));
+}
+
 void nx_emmc_bis_end()
 {
 	_nx_emmc_bis_flush_cache();
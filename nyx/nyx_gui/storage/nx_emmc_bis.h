@@ -223,9 +223,18 @@ typedef struct _nx_emmc_cal0_t
 	u8   console_6axis_sensor_mount_type;
 } __attribute__((packed)) nx_emmc_cal0_t;
 
+typedef struct _nx_emmc_bis_stats_t
+{
+	u32 hits;
+	u32 misses;
+	u32 evictions;
+	u32 writebacks;
+} nx_emmc_bis_stats_t;
+
 int  nx_emmc_bis_read(u32 sector, u32 count, void *buff);
 int nx_emmc_bis_write(u32 sector, u32 count, void *buff);
 void nx_emmc_bis_init(emmc_part_t *part, bool enable_cache, u32 emummc_offset);
+void nx_emmc_bis_get_stats(nx_emmc_bis_stats_t *stats);
 void nx_emmc_bis_end();
 
 #endif
\ No newline at end of file
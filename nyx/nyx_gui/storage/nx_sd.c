@@ -22,10 +22,13 @@
 #include <libs/fatfs/ff.h>
 #include <mem/heap.h>
 
+#define SD_RETUNE_CLEAN_XFERS 2048
+
 static bool sd_mounted = false;
 static bool sd_init_done = false;
 static u16  sd_errors[3] = { 0 }; // Init and Read/Write errors.
 static u32  sd_mode = SD_UHS_SDR104;
+static u32  sd_retunes = 0;
 
 sdmmc_t sd_sdmmc;
 sdmmc_storage_t sd_storage;
@@ -139,6 +142,29 @@ bool sd_initialize(bool power_cycle)
 	return false;
 }
 
+static void _sd_retune_up()
+{
+	// Step up one speed after a clean window. Window doubles on each step up to avoid flapping.
+	if (sd_mode == SD_UHS_SDR104 || sd_mode == SD_INIT_FAIL)
+		return;
+	if (sd_storage.stats.clean < (SD_RETUNE_CLEAN_XFERS << MIN(sd_retunes, 8)))
+		return;
+
+	sdmmc_storage_end(&sd_storage);
+
+	sd_retunes++;
+	sd_mode++;
+	if (!sd_init_retry(false))
+	{
+		// Go back to the last known good speed.
+		sd_mode--;
+		if (!sd_init_retry(false))
+			sd_init_done = false;
+	}
+
+	sd_storage.stats.clean = 0;
+}
+
 bool sd_mount()
 {
 	if (sd_mounted)
@@ -146,6 +172,9 @@ bool sd_mount()
 
 	int res = 0;
 
+	if (sd_init_done)
+		_sd_retune_up();
+
 	if (!sd_init_done)
 		res = !sd_initialize(false);
 